@@ -0,0 +1,54 @@
+#ifndef ART_H
+#define ART_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "row.h"
+#include "search.h"
+
+/* Adaptive radix tree on EZI_ADD (stage 5): branches on whole key bytes,
+   with inner nodes sized to their fanout (4, 16, 48 or 256 children) and
+   single-child chains collapsed into a node prefix. A key's terminating
+   '\0' is one of its bytes, so no key is a prefix of another. */
+typedef struct art_tree art_tree_t;
+
+/* Create an empty tree. Caller frees with free_art_tree(). */
+art_tree_t *create_art_tree(void);
+
+/* Free the tree, its keys and row arrays. */
+void free_art_tree(art_tree_t *t);
+
+/* Insert a (key, row id) pair. If the key is present the row id is
+   appended to its rows. The key is copied. */
+void insert_into_art(art_tree_t *t, const char *key, row_id_t row);
+
+/* Exact lookup with fuzzy fallback. On a hit, push the key's rows. On a
+   miss, push the rows of the closest key (edit distance, then key order)
+   under the deepest node whose whole path the query matches. Counters:
+   n = nodes on the descent (the leaf included), s = 1 if the descent
+   reaches a leaf (its key is compared with the query), b = bits of that
+   comparison; the fuzzy scan is not counted. Caller frees out->results. */
+void search_art(const art_tree_t *t, const char *query, search_stats_t *out);
+
+/* Node counts, memory and depth of a tree */
+typedef struct art_stats {
+    size_t   node4, node16, node48, node256;
+    size_t   leaves;            /* distinct keys */
+    size_t   rows;
+    size_t   node_bytes;        /* inner nodes */
+    size_t   leaf_bytes;        /* leaves with their keys */
+    size_t   row_bytes;         /* row id arrays, used part */
+    size_t   row_slack_bytes;   /* row id arrays, unused capacity */
+    size_t   total_bytes;
+    unsigned max_depth;         /* nodes from the root to a leaf, leaf included */
+    double   avg_depth;         /* mean over leaves: the n of an exact hit */
+} art_stats_t;
+
+/* Walk t once and fill st */
+void art_get_stats(const art_tree_t *t, art_stats_t *st);
+
+/* Print st as a readable report */
+void art_print_stats(const art_stats_t *st, FILE *out);
+
+#endif /* ART_H */
@@ -1,10 +1,35 @@
 #ifndef _BIT_H_
 #define _BIT_H_
 
+#include <stddef.h>
+
 // Number of bits in a byte
 #define BITS_PER_BYTE 8
 
 /* Helper function. Gets the bit at bitIndex from the string s. */
 int getBit(char *s, unsigned int bitIndex);
 
+/* Unchecked getBit for hot loops (no assert, no call). */
+static inline int bit_at(const char *s, unsigned int bitIndex) {
+    unsigned char byte = (unsigned char)s[bitIndex / BITS_PER_BYTE];
+    return (byte >> (BITS_PER_BYTE - 1 - bitIndex % BITS_PER_BYTE)) & 1;
+}
+
+/* bit_at for a string of known length: bits past its terminator read as 0,
+   so the result never depends on memory beyond the string. */
+static inline int bit_at_len(const char *s, size_t len, unsigned int bitIndex) {
+    return (bitIndex / BITS_PER_BYTE < len) ? bit_at(s, bitIndex) : 0;
+}
+
+/* Index of the first byte where a and b differ or, if the strings are
+   equal, of their shared terminating '\0'. Compares a word at a time
+   where both strings have a whole word left, never past either '\0'. */
+size_t first_diff_byte(const char *a, const char *b);
+
+/* MSB-first offset (0..7) of the first differing bit of two unequal bytes. */
+static inline unsigned int byte_diff_bit(unsigned char a, unsigned char b) {
+    return (unsigned int)__builtin_clz((unsigned int)(a ^ b))
+           - (unsigned int)(sizeof(unsigned int) - 1) * BITS_PER_BYTE;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef COLSTORE_H
+#define COLSTORE_H
+
+#include <stddef.h>
+
+#include "row.h"
+
+/* Column-oriented, dictionary-encoded copy of a set of rows, addressed by
+   row id. Each string field is one column: a column holding a single value
+   costs no per-row bytes, low-cardinality columns store 1- or 2-byte codes
+   into a dictionary, and the rest store 4-byte offsets into a shared pool
+   of de-duplicated strings. Coordinates are kept as doubles whenever that
+   prints identically to the parsed long double. */
+typedef struct colstore colstore_t;
+
+/* Build a store from count contiguous rows (row id = index). The store
+   owns copies of every value, so rows may be freed afterwards. Returns
+   NULL on allocation failure. */
+colstore_t *colstore_build(const row_t *rows, size_t count);
+
+/* Free a store built by colstore_build */
+void colstore_free(colstore_t *cs);
+
+/* Number of rows in the store */
+size_t colstore_count(const colstore_t *cs);
+
+/* String field f (0 .. ROW_STR_FIELDS-1, dataset column order) of row id;
+   NULL where the row had no such field. */
+const char *colstore_field(const colstore_t *cs, row_id_t id, int f);
+
+/* Coordinates of row id */
+long double colstore_x(const colstore_t *cs, row_id_t id);
+long double colstore_y(const colstore_t *cs, row_id_t id);
+
+/* Heap bytes held by the store */
+size_t colstore_bytes(const colstore_t *cs);
+
+#endif /* COLSTORE_H */
@@ -4,4 +4,9 @@
 
 row_t *parse_row(char *line);
 
+/* Parse line into row without allocating: the string fields point into
+   line, which is modified in place and must outlive row. Such a row must
+   not be passed to free_row. */
+void parse_row_inplace(row_t *row, char *line);
+
 #endif // CSV_H
\ No newline at end of file
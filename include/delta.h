@@ -0,0 +1,40 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stddef.h>
+
+#include "row.h"
+#include "patricia.h"
+
+/* A delta file is a dataset CSV (header line first) whose data lines are
+   prefixed with an operation:
+     A,<record>   add the record as a new row
+     D,<record>   delete the row with this PFI under this EZI_ADD; with an
+                  empty PFI, delete every row of that EZI_ADD
+     M,<record>   replace the row with this PFI under this EZI_ADD by the
+                  record, keeping its place among the key's rows
+   Only PFI and EZI_ADD of a D record are used. A modify cannot move a row
+   to another key; express that as D plus A. Each line costs one tree
+   descent, so applying a delta is proportional to its size and key
+   lengths, not to the size of the tree. */
+
+/* Outcome of apply_delta */
+typedef struct delta_stats {
+    size_t added;
+    size_t deleted;             /* rows removed */
+    size_t modified;
+    size_t rejected;            /* malformed lines, unknown keys or PFIs */
+} delta_stats_t;
+
+/* Apply filename to t, whose row ids index the *count rows at *rows (a
+   malloc'd array). Added and modified records are appended as new rows
+   with heap-owned fields, so *rows may move and *count grows; replaced
+   rows stay in the array but are no longer referenced by t. Returns 0 on
+   success, -1 if the file cannot be read. */
+int apply_delta(const char *filename, patricia_tree_t *t, row_t **rows,
+                size_t *count, delta_stats_t *st);
+
+/* Free the fields of rows [from, to) appended by apply_delta */
+void free_delta_rows(row_t *rows, size_t from, size_t to);
+
+#endif /* DELTA_H */
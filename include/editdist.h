@@ -0,0 +1,37 @@
+#ifndef EDITDIST_H
+#define EDITDIST_H
+
+#include <stdint.h>
+
+/* Bits per Myers bit-vector word */
+#define ED_WORD_BITS 64
+/* Most candidates scored together by ed_distance_batch */
+#define ED_BATCH 4
+
+/* Query preprocessed for Myers' bit-parallel Levenshtein algorithm.
+   Patterns up to ED_WORD_BITS bytes use one word per text character;
+   longer ones are split into blocks of ED_WORD_BITS rows. */
+typedef struct ed_pattern {
+    int       len;              /* pattern length in bytes */
+    int       blocks;           /* number of 64-row blocks (>= 1) */
+    uint64_t *peq;              /* match masks, peq[c * blocks + block]; NULL when blocks == 1 */
+    uint64_t  single[256];      /* match masks when blocks == 1 */
+} ed_pattern_t;
+
+/* Build the match-mask table for s[0..len). Release with ed_pattern_free. */
+void ed_pattern_init(ed_pattern_t *p, const char *s, int len);
+void ed_pattern_free(ed_pattern_t *p);
+
+/* Levenshtein distance between the pattern and text[0..m) */
+int ed_distance(const ed_pattern_t *p, const char *text, int m);
+
+/* Distance if it is <= bound, otherwise any value > bound. Stops as soon
+   as the remaining text cannot bring the score back under bound. */
+int ed_distance_bounded(const ed_pattern_t *p, const char *text, int m, int bound);
+
+/* Score k <= ED_BATCH texts against the same pattern at once. Uses
+   AVX2/SSE2 lanes when available and the pattern fits in one word. */
+void ed_distance_batch(const ed_pattern_t *p, const char *const texts[],
+                       const int lens[], int k, int out[]);
+
+#endif /* EDITDIST_H */
@@ -0,0 +1,29 @@
+#ifndef EXEC_H
+#define EXEC_H
+
+#include <stdio.h>
+#include "search.h"
+#include "print.h"
+
+/* Answers one query against a read-only index (list or tree). Must be
+   safe to call from several threads at once. */
+typedef void (*query_fn)(void *index, const char *query, search_stats_t *st);
+
+/* Append one answered query in the dict output format: the query line and
+   its records (read from src, or NOTFOUND) to out, the counters summary
+   to summary unless it is NULL. When st->distances is set, each key's
+   rows are preceded by a "distance D: KEY" line. */
+void write_query_result(out_buf_t *out, out_buf_t *summary, const row_source_t *src,
+                        const char *query, const search_stats_t *st);
+
+/* Read queries line by line from in, answer each with fn, and write the
+   results (rows read from src) in input order. Output is formatted into
+   large buffers and written to the descriptors behind fout and summary
+   (after flushing them) in big blocks. With nthreads > 1, queries are read
+   in batches and answered (and formatted) by nthreads - 1 pool threads,
+   started once and woken for each batch, plus the calling thread.
+   With summary NULL no summary lines are formatted at all. */
+void run_queries(FILE *in, FILE *fout, FILE *summary, query_fn fn,
+                 void *index, const row_source_t *src, int nthreads);
+
+#endif /* EXEC_H */
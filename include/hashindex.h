@@ -0,0 +1,29 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "row.h"
+#include "search.h"
+
+/* Open-addressing hash table keyed on EZI_ADD (stage 3). Exact matches
+   only: a query either finds every row with that key or NOTFOUND. */
+typedef struct hash_index hash_index_t;
+
+/* Build an index over count rows where keys[id] is the EZI_ADD of row id
+   (NULL rows are skipped). Row ids sharing a key are grouped in ascending
+   (file) order. The key strings are referenced, not copied, and must
+   outlive the index. Returns NULL on allocation failure. */
+hash_index_t *create_hash_index(const char *const keys[], size_t count);
+
+/* Free the index (the key strings are not owned). */
+void free_hash_index(hash_index_t *h);
+
+/* Look up query and push all of its rows into out. Counters:
+   n = slots probed, s = keys compared (only where the stored hash
+   matches), b = bits compared by those string comparisons. */
+void search_hash_index(const hash_index_t *h, const char *query,
+                       search_stats_t *out);
+
+#endif /* HASHINDEX_H */
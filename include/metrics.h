@@ -0,0 +1,65 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+#include "search.h"
+
+/* Run metrics: wall-clock and CPU time per phase, and histograms of the
+   per-query latency and b/n/s counters. Nothing is collected until
+   metrics_enable(); before that every call below returns at once. */
+
+/* Phases of a run. QUERY spans the whole query loop, WRITE the output
+   writes inside it; the report shows QUERY without WRITE. */
+typedef enum phase {
+    PHASE_READ,         /* mapping or reading the input / snapshot file */
+    PHASE_PARSE,        /* counting and parsing the CSV lines */
+    PHASE_BUILD,        /* building the index (and applying a delta) */
+    PHASE_QUERY,        /* answering and formatting queries */
+    PHASE_WRITE,        /* writing output and summary */
+    PHASE_TEARDOWN,     /* freeing the index and rows */
+    PHASE_COUNT
+} phase_t;
+
+/* Start of a timed span */
+typedef struct phase_mark {
+    double wall;        /* CLOCK_MONOTONIC seconds */
+    double cpu;         /* process CPU seconds (all threads) */
+} phase_mark_t;
+
+/* Power-of-two histogram: bucket 0 counts zeros, bucket k >= 1 counts
+   values in [2^(k-1), 2^k) */
+#define HIST_BUCKETS 65
+typedef struct hist {
+    unsigned long long bucket[HIST_BUCKETS];
+    unsigned long long count;
+    unsigned long long max;
+    double sum;
+} hist_t;
+
+/* Histograms over a set of answered queries */
+typedef struct query_hist {
+    hist_t latency_ns;  /* time inside the query function */
+    hist_t b, n, s;     /* bit, node and string comparisons */
+} query_hist_t;
+
+void metrics_enable(void);
+int  metrics_enabled(void);
+
+phase_mark_t phase_begin(void);
+/* Add the time since mark to phase (safe from any thread) */
+void phase_end(phase_t phase, phase_mark_t mark);
+
+/* Monotonic clock in nanoseconds, for timing single queries */
+unsigned long long metrics_now_ns(void);
+
+void query_hist_init(query_hist_t *h);
+void query_hist_add(query_hist_t *h, unsigned long long ns, const search_stats_t *st);
+/* Merge h into the run totals (safe from any thread) */
+void metrics_add_queries(const query_hist_t *h);
+
+/* Write the phase times and query histograms collected so far as one
+   JSON object */
+void metrics_write_json(FILE *out);
+
+#endif /* METRICS_H */
@@ -1,6 +1,9 @@
 #ifndef PATRICIA_H
 #define PATRICIA_H
 
+#include <stdint.h>
+#include <stdio.h>
+
 #include "row.h"
 #include "search.h"
 
@@ -13,15 +16,239 @@ patricia_tree_t *create_patricia_tree(void);
 /* Free the entire Patricia tree (all nodes & rows array pointers). */
 void free_patricia_tree(patricia_tree_t *t);
 
-/* Insert a (key,row) pair into the tree. If key already present, appends row. */
-void insert_into_patricia(patricia_tree_t *t, const char *key, row_t *row);
+/* Insert a (key,row id) pair into the tree. If key already present, appends
+   the row id. The key is copied. */
+void insert_into_patricia(patricia_tree_t *t, const char *key, row_id_t row);
+
+/* Build a tree over keys[id] -> row id for id < count (NULL keys are
+   skipped), identical in shape and row order to inserting them one by one
+   in id order. The pairs are sorted once, the branch bits are the first
+   differences of adjacent distinct keys, and the tree is assembled from
+   them in a linear pass with branch nodes laid out contiguously in DFS
+   order and leaves in key order. Keys are copied. */
+patricia_tree_t *patricia_bulk_load(const char *const keys[], size_t count);
+
+/* patricia_bulk_load on nthreads threads, with the same result. Pairs
+   are split into buckets on their first two key bytes; buckets are sorted
+   and built into their own slices of the node pools in parallel, and the
+   bucket subtrees are then joined under their branch nodes. */
+patricia_tree_t *patricia_bulk_load_parallel(const char *const keys[], size_t count,
+                                             int nthreads);
+
+/* Row ids stored under exactly key (insertion order), or NULL with
+   *count = 0 if the key is absent. No fuzzy fallback, no counters. */
+const row_id_t *patricia_lookup(const patricia_tree_t *t, const char *key,
+                                unsigned *count);
+
+/* Remove one row id from key's leaf, keeping the others in order; the key
+   itself goes once its last row does. Returns 1 if the row was found. */
+int patricia_remove_row(patricia_tree_t *t, const char *key, row_id_t row);
+
+/* Remove key and all its rows. The leaf's parent branch node is replaced
+   by the sibling subtree, so the tree keeps the shape an insert-only build
+   of the remaining keys would have. Freed nodes are reused by later
+   inserts. Returns the number of rows removed (0 if absent). */
+unsigned patricia_remove_key(patricia_tree_t *t, const char *key);
+
+/* Replace row id old_row by new_row in key's leaf, at the same position.
+   Returns 1 if old_row was found. */
+int patricia_replace_row(patricia_tree_t *t, const char *key,
+                         row_id_t old_row, row_id_t new_row);
 
 /* Search for a key. 
-   - If exact match, all matching rows are pushed into out.
-   - Otherwise, finds the “closest” key by edit distance (Levenshtein).
+   - The rows of the leaf the descent lands on are pushed into out: all
+     matching rows on an exact match, the landing key's rows otherwise.
    - Counters in out are updated (bit/node/string comparisons).
-   - enable_edit_distance can be 0 to disable fuzzy search (just stops at exact leaf). */
+   - For the closest keys by edit distance use search_patricia_topk. */
 void search_patricia(patricia_tree_t *t, const char *query,
                      search_stats_t *out);
 
+/* Search n queries at once; stats[i] receives exactly what
+   search_patricia(t, queries[i], &stats[i]) would. Groups of queries are
+   descended one level at a time in round-robin order with each lane's
+   next node prefetched, hiding memory latency on large trees. */
+void search_patricia_batch(patricia_tree_t *t, const char *const queries[],
+                           size_t n, search_stats_t stats[]);
+
+/* One candidate returned by search_patricia_topk. */
+typedef struct fuzzy_match {
+    const char *key;            /* matched key (owned by the tree) */
+    int         distance;       /* edit distance to the query */
+    unsigned    first;          /* index of this key's first row in out->results */
+    unsigned    count;          /* number of rows for this key */
+    uint32_t    leaf;           /* internal leaf id */
+} fuzzy_match_t;
+
+/* Find the k keys closest to query with edit distance <= max_distance,
+   ordered by distance then key. matches must hold k entries; the number
+   filled is returned. Rows of all matches are pushed into out, grouped per
+   match in that order. The b/n/s counters cover the descent, as in
+   search_patricia; the candidate scan is not counted. Caller frees
+   out->results. The bound prunes the scan, so small k and max_distance
+   make queries cheaper. */
+unsigned search_patricia_topk(patricia_tree_t *t, const char *query,
+                              unsigned k, int max_distance,
+                              fuzzy_match_t *matches, search_stats_t *out);
+
+/* Called by patricia_prefix_each for each key under the prefix, in key
+   order, with that key's row ids. Return 0 to stop the walk. */
+typedef int (*patricia_prefix_fn)(void *ctx, const char *key,
+                                  const row_id_t *rows, unsigned count);
+
+/* Stream every key starting with prefix (and its rows) to fn. The descent
+   follows only the prefix's bits, then one string comparison against a
+   key of the reached subtree confirms the prefix; the cost is the prefix
+   length plus the size of the output, independent of the tree size.
+   out receives the counters of that descent (n, s = 1, b) and no rows.
+   Returns the number of keys passed to fn. */
+unsigned patricia_prefix_each(patricia_tree_t *t, const char *prefix,
+                              patricia_prefix_fn fn, void *ctx,
+                              search_stats_t *out);
+
+/* Push the rows of every key starting with prefix into out, in key order
+   (rows of one key in insertion order), stopping after limit rows
+   (0 = no limit). Counters as for patricia_prefix_each. */
+void search_patricia_prefix(patricia_tree_t *t, const char *prefix,
+                            unsigned limit, search_stats_t *out);
+
+/* ---------- Ordered cursor ---------- */
+
+/* Branching is MSB-first, so child[0] before child[1] is byte-wise
+   lexicographic (strcmp) key order. A cursor walks the keys in that order
+   with an explicit root-to-leaf stack: no recursion and no copying. It
+   must not outlive its tree, and the tree must not be modified while it
+   is in use. */
+typedef struct patricia_cursor patricia_cursor_t;
+
+/* Open an unpositioned cursor on t. Returns NULL on allocation failure. */
+patricia_cursor_t *patricia_cursor_open(const patricia_tree_t *t);
+
+/* Free a cursor */
+void patricia_cursor_close(patricia_cursor_t *c);
+
+/* Position on the smallest / largest key. Return 0 if the tree is empty. */
+int patricia_cursor_first(patricia_cursor_t *c);
+int patricia_cursor_last(patricia_cursor_t *c);
+
+/* Position on the first key >= key; returns 0 (cursor invalid) if there is
+   none. If out is not NULL, the descent is added to its counters (n = nodes
+   visited, s = 1, b = bits up to the first difference). */
+int patricia_cursor_seek(patricia_cursor_t *c, const char *key,
+                         search_stats_t *out);
+
+/* Step to the next / previous key. Return 0, leaving the cursor invalid,
+   when stepping off either end. */
+int patricia_cursor_next(patricia_cursor_t *c);
+int patricia_cursor_prev(patricia_cursor_t *c);
+
+/* 1 if the cursor is on a key */
+int patricia_cursor_valid(const patricia_cursor_t *c);
+
+/* Key under the cursor (owned by the tree), NULL if invalid */
+const char *patricia_cursor_key(const patricia_cursor_t *c);
+
+/* Row ids of the key under the cursor, in insertion order */
+const row_id_t *patricia_cursor_rows(const patricia_cursor_t *c, unsigned *count);
+
+/* Push the rows of every key in [lo, hi) into out, in key order, stopping
+   after limit rows (0 = no limit). hi may be NULL for no upper bound.
+   Counters: the seek to lo as in patricia_cursor_seek, plus one string
+   comparison per key tested against hi. */
+void search_patricia_range(patricia_tree_t *t, const char *lo, const char *hi,
+                           unsigned limit, search_stats_t *out);
+
+/* ---------- Memory & shape statistics ---------- */
+
+#define PAT_STATS_DEPTHS 128    /* depth histogram size; the last bucket
+                                   collects every deeper leaf */
+#define PAT_STATS_DUPS   32     /* rows-per-leaf histogram size */
+
+/* Where a tree's memory goes and how deep its descents are. Byte counts
+   are what the tree owns (pool capacity included); an image-backed tree
+   owns nothing and reports the bytes of the image it borrows, with keys
+   read from its rows (key_bytes 0). */
+typedef struct patricia_stats {
+    int      is_image;
+    size_t   inner_nodes;       /* live branch nodes */
+    size_t   leaves;            /* live leaves (distinct keys) */
+    size_t   rows;              /* row ids over all leaves */
+    size_t   free_inner;        /* removed nodes waiting for reuse */
+    size_t   free_leaves;
+
+    size_t   inner_bytes;       /* branch node pool, allocated capacity */
+    size_t   leaf_bytes;        /* leaf pool, allocated capacity */
+    size_t   pool_slack_bytes;  /* part of the two pools not holding live nodes */
+    size_t   key_bytes;         /* key copies, including the '\0' */
+    size_t   row_bytes;         /* row id arrays, used part (count) */
+    size_t   row_slack_bytes;   /* row id arrays, unused capacity (cap - count) */
+    size_t   total_bytes;       /* the tree struct plus all of the above */
+
+    /* Descent length = nodes visited from the root to a leaf, counting
+       the leaf: the n counter of an exact hit */
+    size_t   depth_hist[PAT_STATS_DEPTHS];  /* leaves per descent length */
+    unsigned max_depth;
+    double   avg_depth;         /* mean over leaves (distinct keys) */
+    double   avg_row_depth;     /* mean over rows (weighted by duplicates) */
+
+    /* Bucket k counts leaves holding [2^k, 2^(k+1)) rows */
+    size_t   dup_hist[PAT_STATS_DUPS];
+    unsigned max_dups;
+} patricia_stats_t;
+
+/* Walk t once and fill st. Returns 0, or -1 if out of memory. */
+int patricia_get_stats(const patricia_tree_t *t, patricia_stats_t *st);
+
+/* Print st as a readable report */
+void patricia_print_stats(const patricia_stats_t *st, FILE *out);
+
+/* ---------- Node layout & flat image (used by snapshots) ---------- */
+
+/* Internal nodes of every tree are pooled pat_inner_t records. Child
+   references are 32-bit indices: with PAT_LEAF_TAG set the low bits index
+   the leaves array, otherwise the inner array. */
+#define PAT_LEAF_TAG 0x80000000u
+#define PAT_NIL      0xFFFFFFFFu
+
+typedef struct pat_inner {
+    uint32_t bitIndex;          /* branching bit position */
+    uint32_t child[2];          /* child for bit = 0 / bit = 1 */
+} pat_inner_t;
+
+typedef struct pat_leaf {
+    uint32_t first;             /* first entry in leaf_rows */
+    uint32_t count;             /* number of rows for this key */
+} pat_leaf_t;
+
+/* Position-independent description of a tree: no pointers, only indices.
+   Leaf rows are row ids (indices into a contiguous row array) and a leaf's
+   key is the EZI_ADD of its first row. */
+typedef struct patricia_image {
+    const pat_inner_t *inner;
+    const pat_leaf_t  *leaves;
+    const uint32_t    *leaf_rows;
+    uint32_t inner_count;
+    uint32_t leaf_count;
+    uint32_t leaf_row_count;
+    uint32_t root;              /* tagged reference, PAT_NIL if empty */
+} patricia_image_t;
+
+/* Flatten t into freshly allocated arrays. Reachable nodes are numbered
+   in preorder (child[0] first), so equal trees give equal images however
+   they were built. Returns 0 on success. Release with patricia_free_image(). */
+int patricia_export_image(const patricia_tree_t *t, patricia_image_t *img);
+
+/* Free arrays allocated by patricia_export_image. */
+void patricia_free_image(patricia_image_t *img);
+
+/* Wrap an image (e.g. inside an mmap'd snapshot) as a read-only tree.
+   No nodes are copied: img's arrays and rows must outlive the tree, and
+   insert_into_patricia must not be called on it. Leaf keys are read from
+   the EZI_ADD of rows[row id]. */
+patricia_tree_t *patricia_from_image(const patricia_image_t *img, const row_t *rows);
+
+/* Editable copy of an image-backed tree: the node pool is copied as is and
+   each leaf's key and row ids are copied out of the image. Linear in the
+   size of the tree, with no parsing, sorting or rebuilding. */
+patricia_tree_t *patricia_thaw(const patricia_tree_t *t);
+
 #endif /* PATRICIA_H */
@@ -1,9 +1,44 @@
 #ifndef PRINT_H
 #define PRINT_H
 #include <stdio.h>
+#include <stddef.h>
 #include "row.h"
+#include "colstore.h"
+
+/* Where the rows behind search results (row ids) are read from: the
+   columnar store when set, otherwise the contiguous row array */
+typedef struct row_source {
+    const row_t      *rows;
+    const colstore_t *store;
+} row_source_t;
+
+/* Growable output buffer. Text is appended in memory and written out in
+   large blocks: with write(2) when fd >= 0, else with fwrite to fp, else
+   (both unset) it only accumulates. */
+typedef struct out_buf {
+    char  *data;
+    size_t len, cap;
+    int    fd;
+    FILE  *fp;
+} out_buf_t;
+
+// Size at which out_put_maybe_flush hands a buffer to the sink
+#define OUT_FLUSH_BYTES (1u << 20)
+
+void out_init(out_buf_t *b, int fd, FILE *fp);
+void out_put(out_buf_t *b, const char *s, size_t n);
+void out_puts(out_buf_t *b, const char *s);
+/* write everything buffered to the sink and empty the buffer */
+void out_flush(out_buf_t *b);
+/* flush once the buffer holds OUT_FLUSH_BYTES or more */
+void out_maybe_flush(out_buf_t *b);
+/* flush, then release the buffer */
+void out_free(out_buf_t *b);
 
 void strip_newline(char *str);
 void print_record(FILE *out, const row_t *a);
 
+/* append row id of src to b in the print_record format */
+void format_row(out_buf_t *b, const row_source_t *src, row_id_t id);
+
 #endif // PRINT_H
\ No newline at end of file
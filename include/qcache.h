@@ -0,0 +1,29 @@
+#ifndef QCACHE_H
+#define QCACHE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "exec.h"
+
+/* Memory-capped LRU cache from query string to its answer (row ids and
+   the b/n/s counters). It wraps any query_fn, so a repeated query is
+   answered from memory with exactly the output of the first run. Safe to
+   share between executor threads. */
+typedef struct query_cache query_cache_t;
+
+/* Cache answers of fn over index, using at most max_bytes for entries
+   (keys, row ids and bookkeeping). Returns NULL on allocation failure. */
+query_cache_t *create_query_cache(query_fn fn, void *index, size_t max_bytes);
+
+/* Free the cache and every entry */
+void free_query_cache(query_cache_t *c);
+
+/* query_fn over a query_cache_t: answer from the cache, or run the
+   wrapped search and remember its result */
+void cached_search(void *cache, const char *query, search_stats_t *st);
+
+/* One line of hit/miss/eviction statistics */
+void query_cache_report(const query_cache_t *c, FILE *out);
+
+#endif /* QCACHE_H */
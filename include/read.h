@@ -1,8 +1,25 @@
 #ifndef READ_H
 #define READ_H
+#include <stddef.h>
 #include "row.h"
 
-// Function to read CSV file and convert to linked list
-node_t *read_csv(const char *filename);
+// Backing storage for a CSV loaded in one shot by read_csv_arena
+typedef struct csv_arena {
+    char   *buf;            // Whole file contents; fields are split in place
+    size_t  len;            // Number of bytes in buf
+    int     mapped;         // 1 if buf is a private mmap of the file
+    char   *tail;           // Copy of a last line that lacks a trailing '\n'
+    row_t  *rows;           // Contiguous array of parsed rows
+    node_t *nodes;          // Contiguous array of list nodes, linked in order
+    size_t  count;          // Number of rows/nodes
+} csv_arena_t;
+
+// Read CSV file into a single arena: the file is memory-mapped and parsed
+// in parallel, row fields point into the mapping, list order is file order
+// and the whole list is released with free_csv_arena
+node_t *read_csv_arena(const char *filename, csv_arena_t *arena);
+
+// Free everything owned by an arena filled by read_csv_arena
+void free_csv_arena(csv_arena_t *arena);
 
 #endif
\ No newline at end of file
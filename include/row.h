@@ -1,10 +1,19 @@
 #ifndef ROW_H
 #define ROW_H
 
+#include <stdint.h>
+
 // Maximum number of fields in a CSV row
 #define MAX_FIELDS 35
 // Maximum length for each field
 #define MAX_FIELD_LEN 127
+// Number of string fields (all columns except the x/y coordinates)
+#define ROW_STR_FIELDS 33
+// Index of EZI_ADD among the string fields
+#define ROW_FIELD_EZI_ADD 1
+
+// Position of a row in file order; search results are reported as row ids
+typedef uint32_t row_id_t;
 
 // Structure representing a single row/record from the CSV file
 typedef struct row_t {
@@ -51,9 +60,13 @@ typedef struct row_t {
 // Linked list node structure for storing rows
 typedef struct node_t {
     row_t *data;            // Pointer to row data
+    row_id_t id;            // Row id (position in file order)
     struct node_t *next;    // Pointer to next node in list
 } node_t;
 
 void free_row(row_t *row);
 
+// Pointers to the string fields of a row, in dataset column order
+void row_fields(row_t *row, char **fields[ROW_STR_FIELDS]);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "row.h"
+#include "patricia.h"
+
+/* Bump whenever the on-disk layout changes */
+#define SNAPSHOT_VERSION 1u
+
+/* A snapshot loaded with snapshot_load: the file stays mapped and the
+   tree's nodes are searched in place; the rows are resolved into a
+   malloc'd row_t array whose fields point into the mapping */
+typedef struct snapshot {
+    void            *map;       /* read-only mapping of the whole file */
+    size_t           len;       /* mapping length */
+    row_t           *rows;      /* rows with fields pointing into map */
+    node_t          *nodes;     /* list over rows, in original file order */
+    uint32_t         count;     /* number of rows */
+    patricia_tree_t *tree;      /* image-backed tree (read-only) */
+} snapshot_t;
+
+/* Write rows (count contiguous rows, in file order) and the tree built
+   over them to path. Returns 0 on success, -1 on error. */
+int snapshot_write(const char *path, const row_t *rows, size_t count,
+                   const patricia_tree_t *tree);
+
+/* Returns 1 if path starts with the snapshot magic */
+int snapshot_is_file(const char *path);
+
+/* Map a snapshot written by snapshot_write. Returns 0 on success, -1 if
+   the file is missing, truncated, from another version/platform, or holds
+   an out-of-range offset, index or malformed tree. */
+int snapshot_load(const char *path, snapshot_t *snap);
+
+/* Release everything held by a loaded snapshot */
+void snapshot_free(snapshot_t *snap);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,43 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <stddef.h>
+
+#include "row.h"
+#include "search.h"
+
+/* Static 2-d tree over the x/y coordinates of a row set (stage 4). Points
+   are bulk-loaded into one array in implicit tree order (each range's
+   median is its splitting node), so the tree has no pointers. Distances
+   are planar, in coordinate units. */
+typedef struct kd_tree kd_tree_t;
+
+/* Build a tree over count points; xy[2 * id], xy[2 * id + 1] are the x and
+   y of row id. The coordinates are copied. Returns NULL on allocation
+   failure. */
+kd_tree_t *create_kd_tree(const double *xy, size_t count);
+
+/* Free a tree built by create_kd_tree */
+void free_kd_tree(kd_tree_t *t);
+
+/* The k rows nearest (x, y), nearest first (ties by row id) */
+void kd_nearest(const kd_tree_t *t, double x, double y, unsigned k,
+                search_stats_t *out);
+
+/* Rows with x0 <= x <= x1 and y0 <= y <= y1, in row id order */
+void kd_box(const kd_tree_t *t, double x0, double y0, double x1, double y1,
+            search_stats_t *out);
+
+/* Rows within distance r of (x, y), nearest first (ties by row id) */
+void kd_radius(const kd_tree_t *t, double x, double y, double r,
+               search_stats_t *out);
+
+/* Answer one query line:
+     near X Y [K]         K nearest rows (default 1)
+     box X0 Y0 X1 Y1      rows inside the box
+     within X Y R         rows within distance R
+   Malformed lines find nothing. Counters: n = tree nodes visited,
+   s = points tested against the query, b = 0. */
+void search_spatial(const kd_tree_t *t, const char *query, search_stats_t *out);
+
+#endif /* SPATIAL_H */
@@ -0,0 +1,597 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "art.h"
+#include "bit.h"     /* first_diff_byte */
+#include "search.h"  /* push_result, strcmp_bits_firstdiff */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ---------- Node types ---------- */
+
+/* Prefix bytes kept in a node. Longer prefixes keep their length only:
+   the descent skips the rest and the leaf comparison catches a mismatch,
+   while inserts read the missing bytes from a leaf below the node. */
+#define ART_PREFIX_MAX 10
+
+enum { ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256 };
+
+/* Header shared by the four inner node sizes */
+typedef struct art_node {
+    uint8_t       type;
+    uint16_t      count;                    /* children */
+    uint32_t      prefix_len;               /* bytes skipped before branching */
+    unsigned char prefix[ART_PREFIX_MAX];   /* first of them */
+} art_node_t;
+
+/* Children of Node4/16 are kept sorted by their key byte */
+typedef struct art_node4 {
+    art_node_t    h;
+    unsigned char keys[4];
+    void         *child[4];
+} art_node4_t;
+
+typedef struct art_node16 {
+    art_node_t    h;
+    unsigned char keys[16];
+    void         *child[16];
+} art_node16_t;
+
+/* index[byte] is the child slot + 1, or 0 when there is no such child */
+typedef struct art_node48 {
+    art_node_t    h;
+    unsigned char index[256];
+    void         *child[48];
+} art_node48_t;
+
+typedef struct art_node256 {
+    art_node_t    h;
+    void         *child[256];
+} art_node256_t;
+
+/* Leaves hold the key inline after their rows */
+typedef struct art_leaf {
+    row_id_t *rows;
+    unsigned  count;
+    unsigned  cap;
+    uint32_t  len;                          /* strlen(key) */
+    char      key[];
+} art_leaf_t;
+
+struct art_tree {
+    void *root;                             /* NULL if empty */
+};
+
+static const size_t NODE_SIZE[4] = {
+    sizeof(art_node4_t), sizeof(art_node16_t), sizeof(art_node48_t), sizeof(art_node256_t)
+};
+
+/* Child references are node pointers, or leaf pointers with the low bit set */
+#define IS_LEAF(ref)   (((uintptr_t)(ref) & 1U) != 0U)
+#define LEAF_OF(ref)   ((art_leaf_t *)((uintptr_t)(ref) & ~(uintptr_t)1U))
+#define LEAF_REF(leaf) ((void *)((uintptr_t)(leaf) | 1U))
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* ---------- Nodes & leaves ---------- */
+
+static void *new_leaf(const char *key, size_t len, row_id_t row) {
+    art_leaf_t *l = malloc(sizeof *l + len + 1);
+    assert(l);
+    l->rows = malloc(sizeof *l->rows);
+    assert(l->rows);
+    l->rows[0] = row;
+    l->count = l->cap = 1U;
+    l->len = (uint32_t)len;
+    memcpy(l->key, key, len + 1);
+    return LEAF_REF(l);
+}
+
+static void leaf_append(art_leaf_t *l, row_id_t row) {
+    if (l->count == l->cap) {
+        l->cap *= 2U;
+        row_id_t *tmp = realloc(l->rows, l->cap * sizeof *l->rows);
+        assert(tmp);
+        l->rows = tmp;
+    }
+    l->rows[l->count++] = row;
+}
+
+static art_node_t *new_node(uint8_t type) {
+    art_node_t *n = calloc(1, NODE_SIZE[type]);
+    assert(n);
+    n->type = type;
+    return n;
+}
+
+static void set_prefix(art_node_t *n, const unsigned char *bytes, size_t len) {
+    n->prefix_len = (uint32_t)len;
+    memmove(n->prefix, bytes, MIN(len, (size_t)ART_PREFIX_MAX));
+}
+
+/* Child of n at or after position *pos in key order, its byte in *c;
+   NULL when there are no more. Advances *pos past it. */
+static void *child_at(const art_node_t *n, unsigned *pos, unsigned char *c) {
+    switch (n->type) {
+    case ART_NODE4: {
+        const art_node4_t *p = (const art_node4_t *)n;
+        if (*pos >= n->count) return NULL;
+        *c = p->keys[*pos];
+        return p->child[(*pos)++];
+    }
+    case ART_NODE16: {
+        const art_node16_t *p = (const art_node16_t *)n;
+        if (*pos >= n->count) return NULL;
+        *c = p->keys[*pos];
+        return p->child[(*pos)++];
+    }
+    case ART_NODE48: {
+        const art_node48_t *p = (const art_node48_t *)n;
+        for (; *pos < 256U; ++*pos) {
+            if (p->index[*pos]) {
+                *c = (unsigned char)*pos;
+                return p->child[p->index[(*pos)++] - 1U];
+            }
+        }
+        return NULL;
+    }
+    default: {
+        const art_node256_t *p = (const art_node256_t *)n;
+        for (; *pos < 256U; ++*pos) {
+            if (p->child[*pos]) {
+                *c = (unsigned char)*pos;
+                return p->child[(*pos)++];
+            }
+        }
+        return NULL;
+    }
+    }
+}
+
+/* Slot of n's child for byte c, or NULL */
+static void **find_child(art_node_t *n, unsigned char c) {
+    switch (n->type) {
+    case ART_NODE4: {
+        art_node4_t *p = (art_node4_t *)n;
+        for (unsigned i = 0; i < n->count; ++i) {
+            if (p->keys[i] == c) return &p->child[i];
+        }
+        return NULL;
+    }
+    case ART_NODE16: {
+        art_node16_t *p = (art_node16_t *)n;
+#if defined(__SSE2__)
+        /* Compare c with all 16 key bytes at once */
+        __m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8((char)c),
+                                    _mm_loadu_si128((const __m128i *)p->keys));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq) & ((1U << n->count) - 1U);
+        return mask ? &p->child[__builtin_ctz(mask)] : NULL;
+#else
+        for (unsigned i = 0; i < n->count; ++i) {
+            if (p->keys[i] == c) return &p->child[i];
+        }
+        return NULL;
+#endif
+    }
+    case ART_NODE48: {
+        art_node48_t *p = (art_node48_t *)n;
+        return p->index[c] ? &p->child[p->index[c] - 1U] : NULL;
+    }
+    default: {
+        art_node256_t *p = (art_node256_t *)n;
+        return p->child[c] ? &p->child[c] : NULL;
+    }
+    }
+}
+
+/* Leftmost leaf under ref; it shares every prefix byte of the nodes above */
+static const art_leaf_t *min_leaf(const void *ref) {
+    while (!IS_LEAF(ref)) {
+        unsigned pos = 0U;
+        unsigned char c;
+        ref = child_at(ref, &pos, &c);
+    }
+    return LEAF_OF(ref);
+}
+
+static void copy_header(art_node_t *dst, const art_node_t *src) {
+    dst->count = src->count;
+    dst->prefix_len = src->prefix_len;
+    memcpy(dst->prefix, src->prefix, sizeof dst->prefix);
+}
+
+/* Add child under byte c to the node at *ref (which has no child for c),
+   growing it to the next size when full */
+static void add_child(void **ref, unsigned char c, void *child) {
+    art_node_t *n = *ref;
+    switch (n->type) {
+    case ART_NODE4: {
+        art_node4_t *p = (art_node4_t *)n;
+        if (n->count < 4U) {
+            unsigned i = n->count;
+            while (i > 0U && p->keys[i - 1U] > c) {
+                p->keys[i] = p->keys[i - 1U];
+                p->child[i] = p->child[i - 1U];
+                i--;
+            }
+            p->keys[i] = c;
+            p->child[i] = child;
+            n->count++;
+            return;
+        }
+        art_node16_t *g = (art_node16_t *)new_node(ART_NODE16);
+        copy_header(&g->h, n);
+        memcpy(g->keys, p->keys, 4);
+        memcpy(g->child, p->child, 4 * sizeof *p->child);
+        free(n);
+        *ref = g;
+        add_child(ref, c, child);
+        return;
+    }
+    case ART_NODE16: {
+        art_node16_t *p = (art_node16_t *)n;
+        if (n->count < 16U) {
+            unsigned i = n->count;
+            while (i > 0U && p->keys[i - 1U] > c) {
+                p->keys[i] = p->keys[i - 1U];
+                p->child[i] = p->child[i - 1U];
+                i--;
+            }
+            p->keys[i] = c;
+            p->child[i] = child;
+            n->count++;
+            return;
+        }
+        art_node48_t *g = (art_node48_t *)new_node(ART_NODE48);
+        copy_header(&g->h, n);
+        for (unsigned i = 0; i < 16U; ++i) {
+            g->index[p->keys[i]] = (unsigned char)(i + 1U);
+            g->child[i] = p->child[i];
+        }
+        free(n);
+        *ref = g;
+        add_child(ref, c, child);
+        return;
+    }
+    case ART_NODE48: {
+        art_node48_t *p = (art_node48_t *)n;
+        if (n->count < 48U) {
+            p->child[n->count] = child;     /* nothing is removed, slots stay dense */
+            p->index[c] = (unsigned char)(++n->count);
+            return;
+        }
+        art_node256_t *g = (art_node256_t *)new_node(ART_NODE256);
+        copy_header(&g->h, n);
+        for (unsigned b = 0; b < 256U; ++b) {
+            if (p->index[b]) g->child[b] = p->child[p->index[b] - 1U];
+        }
+        free(n);
+        *ref = g;
+        add_child(ref, c, child);
+        return;
+    }
+    default: {
+        art_node256_t *p = (art_node256_t *)n;
+        p->child[c] = child;
+        n->count++;
+        return;
+    }
+    }
+}
+
+/* ---------- Public API ---------- */
+
+art_tree_t *create_art_tree(void) {
+    art_tree_t *t = malloc(sizeof *t);
+    assert(t);
+    t->root = NULL;
+    return t;
+}
+
+static void free_ref(void *ref) {
+    if (!ref) return;
+    if (IS_LEAF(ref)) {
+        free(LEAF_OF(ref)->rows);
+        free(LEAF_OF(ref));
+        return;
+    }
+    unsigned pos = 0U;
+    unsigned char c;
+    void *child;
+    while ((child = child_at(ref, &pos, &c)) != NULL) free_ref(child);
+    free(ref);
+}
+
+void free_art_tree(art_tree_t *t) {
+    if (!t) return;
+    free_ref(t->root);
+    free(t);
+}
+
+/* Bytes of n's prefix matching key from depth. Keys end in a '\0' that no
+   shared prefix contains, so the scan stops inside key. */
+static size_t prefix_mismatch(const art_node_t *n, const char *key, size_t depth) {
+    size_t stored = MIN(n->prefix_len, (uint32_t)ART_PREFIX_MAX), i = 0;
+    while (i < stored && n->prefix[i] == (unsigned char)key[depth + i]) i++;
+    if (i < stored || n->prefix_len <= ART_PREFIX_MAX) return i;
+    const art_leaf_t *l = min_leaf(n);
+    while (i < n->prefix_len && l->key[depth + i] == key[depth + i]) i++;
+    return i;
+}
+
+/* Insert below *ref, whose keys share key[0 .. depth) */
+static void insert_at(void **ref, const char *key, size_t len, size_t depth, row_id_t row) {
+    if (!*ref) {
+        *ref = new_leaf(key, len, row);
+        return;
+    }
+    if (IS_LEAF(*ref)) {
+        art_leaf_t *l = LEAF_OF(*ref);
+        if (l->len == len && memcmp(l->key, key, len) == 0) {
+            leaf_append(l, row);
+            return;
+        }
+        /* Split the leaf: a Node4 over the bytes both keys share */
+        size_t i = depth;
+        while (l->key[i] == key[i]) i++;
+        void *n = new_node(ART_NODE4);
+        set_prefix(n, (const unsigned char *)key + depth, i - depth);
+        add_child(&n, (unsigned char)l->key[i], *ref);
+        add_child(&n, (unsigned char)key[i], new_leaf(key, len, row));
+        *ref = n;
+        return;
+    }
+
+    art_node_t *n = *ref;
+    if (n->prefix_len) {
+        size_t p = prefix_mismatch(n, key, depth);
+        if (p < n->prefix_len) {
+            /* Split the prefix: a Node4 over its first p bytes, n keeps
+               what follows the branching byte */
+            const unsigned char *full = n->prefix_len > ART_PREFIX_MAX
+                                      ? (const unsigned char *)min_leaf(n)->key + depth
+                                      : n->prefix;
+            void *top = new_node(ART_NODE4);
+            set_prefix(top, full, p);
+            unsigned char c = full[p];
+            set_prefix(n, full + p + 1, n->prefix_len - p - 1);
+            add_child(&top, c, n);
+            add_child(&top, (unsigned char)key[depth + p], new_leaf(key, len, row));
+            *ref = top;
+            return;
+        }
+        depth += n->prefix_len;
+    }
+    void **child = find_child(n, (unsigned char)key[depth]);
+    if (child) {
+        insert_at(child, key, len, depth + 1, row);
+        return;
+    }
+    add_child(ref, (unsigned char)key[depth], new_leaf(key, len, row));
+}
+
+void insert_into_art(art_tree_t *t, const char *key, row_id_t row) {
+    assert(t && key);
+    insert_at(&t->root, key, strlen(key), 0, row);
+}
+
+/* ---------- Search ---------- */
+
+/* Fuzzy scan of one subtree: one Levenshtein DP row (query along the
+   columns) per key byte on the current path, shared by every key below;
+   a subtree whose row minimum cannot beat the best key so far is skipped.
+   Keys are visited in order, so the first key at the best distance wins. */
+typedef struct art_scan {
+    const char       *q;
+    int               qlen;
+    int              *rows;             /* rows[i * (qlen + 1) + j] */
+    int              *row_min;          /* minimum of each row */
+    size_t            rows_cap;
+    const art_leaf_t *best;
+    int               best_d;
+} art_scan_t;
+
+/* Row i + 1 from row i and key byte c */
+static void extend_row(art_scan_t *fs, size_t i, char c) {
+    size_t w = (size_t)fs->qlen + 1;
+    if (i + 1 >= fs->rows_cap) {
+        while (i + 1 >= fs->rows_cap) fs->rows_cap *= 2;
+        fs->rows = realloc(fs->rows, fs->rows_cap * w * sizeof *fs->rows);
+        fs->row_min = realloc(fs->row_min, fs->rows_cap * sizeof *fs->row_min);
+        assert(fs->rows && fs->row_min);
+    }
+    const int *prev = fs->rows + i * w;
+    int *cur = fs->rows + (i + 1) * w;
+    cur[0] = (int)i + 1;
+    int m = cur[0];
+    for (int j = 1; j <= fs->qlen; ++j) {
+        int v = (c == fs->q[j - 1]) ? prev[j - 1] : prev[j - 1] + 1;
+        if (prev[j] + 1 < v) v = prev[j] + 1;
+        if (cur[j - 1] + 1 < v) v = cur[j - 1] + 1;
+        cur[j] = v;
+        if (v < m) m = v;
+    }
+    fs->row_min[i + 1] = m;
+}
+
+/* Nothing under a path whose row minimum is this far can win */
+static int scan_pruned(const art_scan_t *fs, size_t depth) {
+    return fs->best && fs->row_min[depth] >= fs->best_d;
+}
+
+/* Scan ref, whose keys share the depth bytes rows 0 .. depth describe */
+static void scan_subtree(art_scan_t *fs, const void *ref, size_t depth) {
+    if (scan_pruned(fs, depth)) return;
+    if (IS_LEAF(ref)) {
+        const art_leaf_t *l = LEAF_OF(ref);
+        for (size_t i = depth; i < l->len; ++i) {
+            extend_row(fs, i, l->key[i]);
+            if (scan_pruned(fs, i + 1)) return;
+        }
+        int d = fs->rows[(size_t)l->len * ((size_t)fs->qlen + 1) + (size_t)fs->qlen];
+        if (!fs->best || d < fs->best_d) {
+            fs->best = l;
+            fs->best_d = d;
+        }
+        return;
+    }
+    const art_node_t *n = ref;
+    if (n->prefix_len) {
+        const char *pre = n->prefix_len > ART_PREFIX_MAX ? min_leaf(n)->key + depth
+                                                         : (const char *)n->prefix;
+        for (size_t i = 0; i < n->prefix_len; ++i) extend_row(fs, depth + i, pre[i]);
+        depth += n->prefix_len;
+        if (scan_pruned(fs, depth)) return;
+    }
+    unsigned pos = 0U;
+    unsigned char c;
+    const void *child;
+    while ((child = child_at(n, &pos, &c)) != NULL) {
+        if (c == 0U) {                      /* the key ending here */
+            scan_subtree(fs, child, depth);
+            continue;
+        }
+        extend_row(fs, depth, (char)c);
+        scan_subtree(fs, child, depth + 1);
+    }
+}
+
+/* Miss below stop: find the deepest node on the query's path whose whole
+   prefix the query matches and push the rows of its closest key */
+static void fuzzy_fallback(const art_tree_t *t, const char *query, size_t qlen,
+                           const void *stop, search_stats_t *out) {
+    const art_leaf_t *near = min_leaf(stop);
+    size_t diff = first_diff_byte(query, near->key);
+
+    const void *ref = t->root, *scan = t->root;
+    size_t depth = 0, scan_depth = 0;
+    while (!IS_LEAF(ref)) {
+        const art_node_t *n = ref;
+        size_t branch = depth + n->prefix_len;
+        if (branch > diff) break;
+        scan = ref;
+        scan_depth = depth;
+        ref = *find_child((art_node_t *)n, (unsigned char)near->key[branch]);
+        depth = branch + 1;
+    }
+
+    art_scan_t fs;
+    fs.q = query;
+    fs.qlen = (int)qlen;
+    fs.rows_cap = 64;
+    fs.rows = malloc(fs.rows_cap * (qlen + 1) * sizeof *fs.rows);
+    fs.row_min = malloc(fs.rows_cap * sizeof *fs.row_min);
+    assert(fs.rows && fs.row_min);
+    for (size_t j = 0; j <= qlen; ++j) fs.rows[j] = (int)j;   /* empty key prefix */
+    fs.row_min[0] = 0;
+    fs.best = NULL;
+    fs.best_d = 0;
+    for (size_t i = 0; i < scan_depth; ++i) extend_row(&fs, i, near->key[i]);
+    scan_subtree(&fs, scan, scan_depth);
+
+    if (fs.best) {
+        for (unsigned i = 0; i < fs.best->count; ++i) push_result(out, fs.best->rows[i]);
+    }
+    free(fs.rows);
+    free(fs.row_min);
+}
+
+void search_art(const art_tree_t *t, const char *query, search_stats_t *out) {
+    out->results = NULL;
+    out->result_count = 0U;
+    out->capacity = 0U;
+    out->bit_comparisons = 0ULL;
+    out->node_comparisons = 0U;
+    out->string_comparisons = 0U;
+    out->distances = NULL;
+    if (!t || !t->root) return;
+
+    /* Descend on whole bytes. Stored prefix bytes are checked; the rest of
+       a long prefix is only skipped, the leaf comparison settles it. */
+    size_t qlen = strlen(query), depth = 0;
+    const void *ref = t->root;
+    while (!IS_LEAF(ref)) {
+        const art_node_t *n = ref;
+        out->node_comparisons++;
+        if (n->prefix_len) {
+            size_t stored = MIN(n->prefix_len, (uint32_t)ART_PREFIX_MAX), i = 0;
+            while (i < stored && n->prefix[i] == (unsigned char)query[depth + i]) i++;
+            depth += n->prefix_len;
+            if (i < stored || depth > qlen) {
+                fuzzy_fallback(t, query, qlen, ref, out);
+                return;
+            }
+        }
+        void **child = find_child((art_node_t *)n, (unsigned char)query[depth]);
+        if (!child) {
+            fuzzy_fallback(t, query, qlen, ref, out);
+            return;
+        }
+        ref = *child;
+        depth++;
+    }
+
+    const art_leaf_t *l = LEAF_OF(ref);
+    out->node_comparisons++;                /* the leaf */
+    out->string_comparisons++;
+    if (strcmp_bits_firstdiff(query, l->key, &out->bit_comparisons) != 0) {
+        fuzzy_fallback(t, query, qlen, ref, out);
+        return;
+    }
+    for (unsigned i = 0; i < l->count; ++i) push_result(out, l->rows[i]);
+}
+
+/* ---------- Statistics ---------- */
+
+static void stats_walk(const void *ref, unsigned depth, art_stats_t *st, double *depth_sum) {
+    if (IS_LEAF(ref)) {
+        const art_leaf_t *l = LEAF_OF(ref);
+        st->leaves++;
+        st->rows += l->count;
+        st->leaf_bytes += sizeof *l + l->len + 1U;
+        st->row_bytes += (size_t)l->count * sizeof *l->rows;
+        st->row_slack_bytes += (size_t)(l->cap - l->count) * sizeof *l->rows;
+        if (depth > st->max_depth) st->max_depth = depth;
+        *depth_sum += depth;
+        return;
+    }
+    const art_node_t *n = ref;
+    switch (n->type) {
+    case ART_NODE4:  st->node4++;   break;
+    case ART_NODE16: st->node16++;  break;
+    case ART_NODE48: st->node48++;  break;
+    default:         st->node256++; break;
+    }
+    st->node_bytes += NODE_SIZE[n->type];
+    unsigned pos = 0U;
+    unsigned char c;
+    const void *child;
+    while ((child = child_at(n, &pos, &c)) != NULL) stats_walk(child, depth + 1U, st, depth_sum);
+}
+
+void art_get_stats(const art_tree_t *t, art_stats_t *st) {
+    memset(st, 0, sizeof *st);
+    double depth_sum = 0.0;
+    if (t->root) stats_walk(t->root, 1U, st, &depth_sum);
+    if (st->leaves) st->avg_depth = depth_sum / (double)st->leaves;
+    st->total_bytes = sizeof *t + st->node_bytes + st->leaf_bytes
+                    + st->row_bytes + st->row_slack_bytes;
+}
+
+void art_print_stats(const art_stats_t *st, FILE *out) {
+    fprintf(out, "Adaptive radix tree\n");
+    fprintf(out, "  nodes: %zu Node4, %zu Node16, %zu Node48, %zu Node256, "
+                 "%zu leaf (distinct keys), %zu rows\n",
+            st->node4, st->node16, st->node48, st->node256, st->leaves, st->rows);
+    fprintf(out, "  bytes: %zu total\n", st->total_bytes);
+    fprintf(out, "    inner nodes   %12zu\n", st->node_bytes);
+    fprintf(out, "    leaves + keys %12zu\n", st->leaf_bytes);
+    fprintf(out, "    leaf rows     %12zu\n", st->row_bytes);
+    fprintf(out, "    rows slack    %12zu  (cap - count)\n", st->row_slack_bytes);
+    fprintf(out, "  descent length (nodes, leaf included): avg %.2f per key, max %u\n",
+            st->avg_depth, st->max_depth);
+}
@@ -1,9 +1,8 @@
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 #include "bit.h"
 
-/* Number of bits in a single character. */
-#define BITS_PER_BYTE 8
-
 int getBit(char *s, unsigned int bitIndex){
     assert(s);
     unsigned int byte = bitIndex / BITS_PER_BYTE;
@@ -23,4 +22,34 @@ int getBit(char *s, unsigned int bitIndex){
     */
     unsigned int bitOnly = maskedByte >> offset;
     return bitOnly;
+}
+/* Bytes compared at once by first_diff_byte. */
+#define WORD_BYTES 8U
+
+size_t first_diff_byte(const char *a, const char *b) {
+    const unsigned char *pa = (const unsigned char *)a;
+    const unsigned char *pb = (const unsigned char *)b;
+    size_t la = strlen(a), lb = strlen(b);
+    size_t n = la < lb ? la : lb;          /* bytes before either '\0' */
+    size_t i = 0;
+
+    /* Whole words only while both strings have WORD_BYTES bytes left. */
+    for (; i + WORD_BYTES <= n; i += WORD_BYTES) {
+        uint64_t wa, wb;
+        memcpy(&wa, pa + i, WORD_BYTES);
+        memcpy(&wb, pb + i, WORD_BYTES);
+        uint64_t diff = wa ^ wb;
+        if (!diff) continue;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return i + (size_t)__builtin_clzll(diff) / BITS_PER_BYTE;
+#else
+        return i + (size_t)__builtin_ctzll(diff) / BITS_PER_BYTE;
+#endif
+    }
+    /* Tail one byte at a time. */
+    for (; i < n; i++) {
+        if (pa[i] != pb[i]) return i;
+    }
+    /* Byte n is the '\0' of the shorter string (of both if equal). */
+    return n;
 }
\ No newline at end of file
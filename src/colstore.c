@@ -0,0 +1,268 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "colstore.h"
+
+#define CS_NULL 0xFFFFFFFFu             /* pool offset of an absent field */
+
+/* How a column stores its per-row values */
+enum col_kind {
+    COL_CONST,                          /* one value for every row, no codes */
+    COL_DICT8,                          /* uint8_t code into dict */
+    COL_DICT16,                         /* uint16_t code into dict */
+    COL_OFFSET                          /* uint32_t pool offset per row */
+};
+
+typedef struct column {
+    int       kind;
+    uint32_t *dict;                     /* pool offsets of distinct values */
+    uint32_t  ndict;
+    void     *codes;                    /* per-row codes or offsets */
+} column_t;
+
+struct colstore {
+    size_t       count;
+    char        *pool;                  /* de-duplicated strings, "" at 0 */
+    size_t       pool_len, pool_cap;
+    column_t     cols[ROW_STR_FIELDS];
+    double      *xy;                    /* x, y per row when exact, else NULL */
+    long double *xy_wide;               /* x, y per row otherwise */
+};
+
+/* ---------- Building ---------- */
+
+/* Open-addressing set of the distinct values of one column; slots hold
+   dictionary indices (UINT32_MAX = empty) */
+typedef struct intern {
+    uint32_t *slots;
+    size_t    mask;
+    uint32_t  null_code;                /* dictionary index of NULL, if seen */
+} intern_t;
+
+static uint32_t hash_str(const char *s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Append s to the pool; returns its offset */
+static uint32_t pool_add(colstore_t *cs, const char *s) {
+    size_t n = strlen(s) + 1;
+    if (cs->pool_len + n > cs->pool_cap) {
+        while (cs->pool_len + n > cs->pool_cap) cs->pool_cap *= 2;
+        cs->pool = realloc(cs->pool, cs->pool_cap);
+        assert(cs->pool);
+    }
+    assert(cs->pool_len + n < CS_NULL);
+    memcpy(cs->pool + cs->pool_len, s, n);
+    cs->pool_len += n;
+    return (uint32_t)(cs->pool_len - n);
+}
+
+/* Dictionary index of value s in column c, adding it if new */
+static uint32_t intern_value(colstore_t *cs, column_t *c, intern_t *in,
+                             const char *s, uint32_t *dict_cap) {
+    size_t i = 0;
+    if (s) {
+        i = hash_str(s) & in->mask;
+        while (in->slots[i] != UINT32_MAX) {
+            if (strcmp(cs->pool + c->dict[in->slots[i]], s) == 0)
+                return in->slots[i];
+            i = (i + 1) & in->mask;
+        }
+    } else if (in->null_code != CS_NULL) {
+        return in->null_code;
+    }
+
+    if (c->ndict == *dict_cap) {
+        *dict_cap *= 2U;
+        c->dict = realloc(c->dict, *dict_cap * sizeof *c->dict);
+        assert(c->dict);
+    }
+    uint32_t code = c->ndict++;
+    if (!s) {
+        c->dict[code] = CS_NULL;
+        in->null_code = code;
+        return code;
+    }
+    c->dict[code] = *s ? pool_add(cs, s) : 0U;
+    in->slots[i] = code;
+
+    /* Keep the set at most half full */
+    if ((size_t)c->ndict * 2U > in->mask) {
+        size_t ncap = (in->mask + 1U) * 2U;
+        uint32_t *ns = malloc(ncap * sizeof *ns);
+        assert(ns);
+        memset(ns, 0xFF, ncap * sizeof *ns);
+        for (size_t k = 0; k <= in->mask; ++k) {
+            uint32_t d = in->slots[k];
+            if (d == UINT32_MAX) continue;
+            size_t j = hash_str(cs->pool + c->dict[d]) & (ncap - 1U);
+            while (ns[j] != UINT32_MAX) j = (j + 1) & (ncap - 1U);
+            ns[j] = d;
+        }
+        free(in->slots);
+        in->slots = ns;
+        in->mask = ncap - 1U;
+    }
+    return code;
+}
+
+/* Encode field f of every row into column c */
+static void build_column(colstore_t *cs, column_t *c, const row_t *rows,
+                         int f, uint32_t *tmp) {
+    intern_t in;
+    in.mask = 255U;
+    in.slots = malloc((in.mask + 1U) * sizeof *in.slots);
+    assert(in.slots);
+    memset(in.slots, 0xFF, (in.mask + 1U) * sizeof *in.slots);
+    in.null_code = CS_NULL;
+    uint32_t dict_cap = 16U;
+    c->dict = malloc(dict_cap * sizeof *c->dict);
+    c->ndict = 0U;
+    assert(c->dict);
+
+    for (size_t i = 0; i < cs->count; ++i) {
+        char **fields[ROW_STR_FIELDS];
+        row_fields((row_t *)&rows[i], fields);
+        tmp[i] = intern_value(cs, c, &in, *fields[f], &dict_cap);
+    }
+    free(in.slots);
+
+    c->codes = NULL;
+    if (c->ndict <= 1U) {
+        c->kind = COL_CONST;
+    } else if (c->ndict <= 256U) {
+        c->kind = COL_DICT8;
+        uint8_t *codes = malloc(cs->count);
+        assert(codes);
+        for (size_t i = 0; i < cs->count; ++i) codes[i] = (uint8_t)tmp[i];
+        c->codes = codes;
+    } else if (c->ndict <= 65536U) {
+        c->kind = COL_DICT16;
+        uint16_t *codes = malloc(cs->count * sizeof *codes);
+        assert(codes);
+        for (size_t i = 0; i < cs->count; ++i) codes[i] = (uint16_t)tmp[i];
+        c->codes = codes;
+    } else {
+        /* Near-unique column: store the pool offset itself */
+        c->kind = COL_OFFSET;
+        uint32_t *offs = malloc(cs->count * sizeof *offs);
+        assert(offs);
+        for (size_t i = 0; i < cs->count; ++i) offs[i] = c->dict[tmp[i]];
+        c->codes = offs;
+        free(c->dict);
+        c->dict = NULL;
+        c->ndict = 0U;
+        return;
+    }
+    c->dict = realloc(c->dict, (c->ndict ? c->ndict : 1U) * sizeof *c->dict);
+}
+
+/* 1 if v prints with %f as a double exactly as with %Lf. Only values
+   whose sixth decimal is within rounding distance of a tie can differ, so
+   the string comparison is rarely needed. */
+static int double_prints_same(long double v) {
+    long double scaled = v * 1e6L;
+    if (scaled > 9e18L || scaled < -9e18L) return 0;
+    long double frac = scaled - (long double)(long long)scaled;
+    if (frac < 0) frac = -frac;
+    if (frac < 0.5L - 1e-6L || frac > 0.5L + 1e-6L) return 1;
+    char a[64], b[64];
+    snprintf(a, sizeof a, "%Lf", v);
+    snprintf(b, sizeof b, "%f", (double)v);
+    return strcmp(a, b) == 0;
+}
+
+colstore_t *colstore_build(const row_t *rows, size_t count) {
+    assert(count < CS_NULL);
+    colstore_t *cs = calloc(1, sizeof *cs);
+    uint32_t *tmp = malloc((count ? count : 1U) * sizeof *tmp);
+    if (!cs || !tmp) { free(cs); free(tmp); return NULL; }
+    cs->count = count;
+    cs->pool_cap = 4096U;
+    cs->pool = malloc(cs->pool_cap);
+    assert(cs->pool);
+    cs->pool[0] = '\0';
+    cs->pool_len = 1U;
+
+    for (int f = 0; f < ROW_STR_FIELDS; ++f)
+        build_column(cs, &cs->cols[f], rows, f, tmp);
+    free(tmp);
+    cs->pool = realloc(cs->pool, cs->pool_len);
+
+    int exact = 1;
+    for (size_t i = 0; i < count && exact; ++i)
+        exact = double_prints_same(rows[i].x) && double_prints_same(rows[i].y);
+    if (exact) {
+        cs->xy = malloc((count ? count : 1U) * 2U * sizeof *cs->xy);
+        assert(cs->xy);
+        for (size_t i = 0; i < count; ++i) {
+            cs->xy[2 * i]     = (double)rows[i].x;
+            cs->xy[2 * i + 1] = (double)rows[i].y;
+        }
+    } else {
+        cs->xy_wide = malloc((count ? count : 1U) * 2U * sizeof *cs->xy_wide);
+        assert(cs->xy_wide);
+        for (size_t i = 0; i < count; ++i) {
+            cs->xy_wide[2 * i]     = rows[i].x;
+            cs->xy_wide[2 * i + 1] = rows[i].y;
+        }
+    }
+    return cs;
+}
+
+void colstore_free(colstore_t *cs) {
+    if (!cs) return;
+    for (int f = 0; f < ROW_STR_FIELDS; ++f) {
+        free(cs->cols[f].dict);
+        free(cs->cols[f].codes);
+    }
+    free(cs->pool);
+    free(cs->xy);
+    free(cs->xy_wide);
+    free(cs);
+}
+
+/* ---------- Access ---------- */
+
+size_t colstore_count(const colstore_t *cs) {
+    return cs->count;
+}
+
+const char *colstore_field(const colstore_t *cs, row_id_t id, int f) {
+    const column_t *c = &cs->cols[f];
+    uint32_t off;
+    switch (c->kind) {
+    case COL_CONST:  off = c->ndict ? c->dict[0] : CS_NULL; break;
+    case COL_DICT8:  off = c->dict[((const uint8_t *)c->codes)[id]]; break;
+    case COL_DICT16: off = c->dict[((const uint16_t *)c->codes)[id]]; break;
+    default:         off = ((const uint32_t *)c->codes)[id]; break;
+    }
+    return off == CS_NULL ? NULL : cs->pool + off;
+}
+
+long double colstore_x(const colstore_t *cs, row_id_t id) {
+    return cs->xy ? (long double)cs->xy[2 * (size_t)id] : cs->xy_wide[2 * (size_t)id];
+}
+
+long double colstore_y(const colstore_t *cs, row_id_t id) {
+    return cs->xy ? (long double)cs->xy[2 * (size_t)id + 1] : cs->xy_wide[2 * (size_t)id + 1];
+}
+
+size_t colstore_bytes(const colstore_t *cs) {
+    static const size_t code_size[] = { 0U, 1U, 2U, 4U };
+    size_t bytes = sizeof *cs + cs->pool_len;
+    for (int f = 0; f < ROW_STR_FIELDS; ++f) {
+        const column_t *c = &cs->cols[f];
+        bytes += (size_t)c->ndict * sizeof *c->dict
+               + cs->count * code_size[c->kind];
+    }
+    bytes += cs->count * 2U * (cs->xy ? sizeof *cs->xy : sizeof *cs->xy_wide);
+    return bytes;
+}
@@ -30,14 +30,8 @@ static int split_csv(char *line, char *tokens[], int max_fields) {
     return count;
 }
 
-/* Parse a single CSV line into row_t structure */
-row_t *parse_row(char *line) {
-    if (!line) return NULL;                 // Return NULL for invalid input
-    
-    // Allocate and initialize row structure
-    row_t *row = calloc(1, sizeof(row_t));
-    if (!row) return NULL;                  // Return NULL if allocation fails
-
+/* Split line and assign fields of row, duplicating strings if copy != 0 */
+static void fill_row(row_t *row, char *line, int copy) {
     char *tokens[MAX_FIELDS] = {0};         // Array for field tokens
     int i = split_csv(line, tokens, MAX_FIELDS);  // Split line into tokens
 
@@ -58,12 +52,30 @@ row_t *parse_row(char *line) {
 
     // Assign string fields from tokens
     for (int j = 0; j < num_fields && j < i; j++) {
-        *fields[j] = dup_string(tokens[j]);  // Duplicate and assign each token
+        // Duplicate each token, or point straight into the line buffer
+        *fields[j] = copy ? dup_string(tokens[j]) : tokens[j];
     }
 
     // Handle numeric coordinate fields (last two fields)
     if (i > 33) row->x = strtold(tokens[33], NULL);  // Convert x coordinate
     if (i > 34) row->y = strtold(tokens[34], NULL);  // Convert y coordinate
+}
 
+/* Parse a single CSV line into row_t structure */
+row_t *parse_row(char *line) {
+    if (!line) return NULL;                 // Return NULL for invalid input
+    
+    // Allocate and initialize row structure
+    row_t *row = calloc(1, sizeof(row_t));
+    if (!row) return NULL;                  // Return NULL if allocation fails
+
+    fill_row(row, line, 1);
     return row;
+}
+
+/* Parse a single CSV line into a caller-owned row without copying fields */
+void parse_row_inplace(row_t *row, char *line) {
+    if (!row || !line) return;              // Do nothing for invalid input
+    memset(row, 0, sizeof(*row));           // Fields missing from line stay NULL
+    fill_row(row, line, 0);
 }
\ No newline at end of file
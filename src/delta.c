@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "csv.h"
+
+/* Growable view of the caller's row array */
+typedef struct row_array {
+    row_t  **rows;
+    size_t  *count;
+    size_t   cap;
+} row_array_t;
+
+/* Append the fields of a parsed row (taking them over); returns its id */
+static row_id_t append_row(row_array_t *a, row_t *row) {
+    if (*a->count == a->cap) {
+        a->cap += a->cap / 2U + 16U;
+        row_t *tmp = realloc(*a->rows, a->cap * sizeof *tmp);
+        assert(tmp);
+        *a->rows = tmp;
+    }
+    (*a->rows)[*a->count] = *row;
+    free(row);                          /* the fields now belong to the array */
+    return (row_id_t)(*a->count)++;
+}
+
+/* Row id under key whose PFI is pfi; returns 0 if there is none */
+static int find_pfi(const patricia_tree_t *t, const row_t *rows,
+                    const char *key, const char *pfi, row_id_t *id) {
+    unsigned n;
+    const row_id_t *ids = patricia_lookup(t, key, &n);
+    for (unsigned i = 0; i < n; ++i) {
+        const char *p = rows[ids[i]].PFI;
+        if (p && strcmp(p, pfi) == 0) {
+            *id = ids[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Apply one "op,record" line; returns 0 if it was rejected */
+static int apply_line(patricia_tree_t *t, row_array_t *a, char *line,
+                      delta_stats_t *st) {
+    char op = line[0];
+    if ((op != 'A' && op != 'D' && op != 'M') || line[1] != ',') return 0;
+    row_t *row = parse_row(line + 2);
+    if (!row) return 0;
+    if (!row->EZI_ADD || !*row->EZI_ADD) { free_row(row); return 0; }
+
+    row_id_t old;
+    switch (op) {
+    case 'A': {
+        row_id_t id = append_row(a, row);
+        insert_into_patricia(t, (*a->rows)[id].EZI_ADD, id);
+        st->added++;
+        return 1;
+    }
+    case 'D':
+        if (!row->PFI || !*row->PFI) {
+            unsigned n = patricia_remove_key(t, row->EZI_ADD);
+            st->deleted += n;
+            free_row(row);
+            return n != 0U;
+        }
+        if (!find_pfi(t, *a->rows, row->EZI_ADD, row->PFI, &old)) { free_row(row); return 0; }
+        patricia_remove_row(t, row->EZI_ADD, old);
+        st->deleted++;
+        free_row(row);
+        return 1;
+    default:
+        if (!row->PFI || !find_pfi(t, *a->rows, row->EZI_ADD, row->PFI, &old)) {
+            free_row(row);
+            return 0;
+        }
+        row_id_t id = append_row(a, row);
+        patricia_replace_row(t, (*a->rows)[id].EZI_ADD, old, id);
+        st->modified++;
+        return 1;
+    }
+}
+
+int apply_delta(const char *filename, patricia_tree_t *t, row_t **rows,
+                size_t *count, delta_stats_t *st) {
+    memset(st, 0, sizeof *st);
+    FILE *fp = fopen(filename, "r");
+    if (!fp) return -1;
+
+    row_array_t a = { rows, count, *count };
+    char *line = NULL;
+    size_t cap = 0;
+    // Skip header row (first line)
+    if (getline(&line, &cap, fp) < 0) {
+        free(line);
+        fclose(fp);
+        return 0;
+    }
+    while (getline(&line, &cap, fp) >= 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!*line) continue;
+        if (!apply_line(t, &a, line, st)) st->rejected++;
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+}
+
+void free_delta_rows(row_t *rows, size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+        char **fields[ROW_STR_FIELDS];
+        row_fields(&rows[i], fields);
+        for (int f = 0; f < ROW_STR_FIELDS; ++f) free(*fields[f]);
+    }
+}
@@ -0,0 +1,257 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "editdist.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ED_X86 1
+#endif
+
+/* Number of blocks whose state fits in a stack buffer */
+#define ED_STACK_BLOCKS 16
+
+static const uint64_t HIGH_BIT = 1ULL << (ED_WORD_BITS - 1);
+
+void ed_pattern_init(ed_pattern_t *p, const char *s, int len) {
+    assert(p && len >= 0 && (s || len == 0));
+    p->len = len;
+    p->blocks = len > 0 ? (len + ED_WORD_BITS - 1) / ED_WORD_BITS : 1;
+    p->peq = NULL;
+
+    uint64_t *peq = p->single;
+    if (p->blocks > 1) {
+        p->peq = calloc((size_t)256 * p->blocks, sizeof *p->peq);
+        assert(p->peq);
+        peq = p->peq;
+    } else {
+        memset(p->single, 0, sizeof p->single);
+    }
+
+    // Bit i of block b is set where pattern row b * 64 + i holds c
+    for (int i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        peq[c * p->blocks + i / ED_WORD_BITS] |= 1ULL << (i % ED_WORD_BITS);
+    }
+}
+
+void ed_pattern_free(ed_pattern_t *p) {
+    if (!p) return;
+    free(p->peq);
+    p->peq = NULL;
+}
+
+/* Advance one 64-row block by one text column (Myers/Hyyrö step).
+   hin is the horizontal delta entering the block's top row, the return
+   value is the delta leaving the row selected by out_bit. */
+static inline int advance_block(uint64_t *Pv, uint64_t *Mv, uint64_t Eq,
+                                int hin, uint64_t out_bit) {
+    uint64_t Xv = Eq | *Mv;
+    if (hin < 0) Eq |= 1ULL;
+    uint64_t Xh = (((Eq & *Pv) + *Pv) ^ *Pv) | Eq;
+    uint64_t Ph = *Mv | ~(Xh | *Pv);
+    uint64_t Mh = *Pv & Xh;
+
+    int hout = (Ph & out_bit) ? 1 : ((Mh & out_bit) ? -1 : 0);
+
+    Ph <<= 1;
+    Mh <<= 1;
+    if (hin < 0)      Mh |= 1ULL;
+    else if (hin > 0) Ph |= 1ULL;
+    *Pv = Mh | ~(Xv | Ph);
+    *Mv = Ph & Xv;
+    return hout;
+}
+
+/* Single-word path: pattern of 1..64 bytes. */
+static int myers_single(const ed_pattern_t *p, const unsigned char *t, int m, int bound) {
+    const uint64_t *peq = p->single;
+    uint64_t last = 1ULL << (p->len - 1);
+    uint64_t Pv = ~0ULL, Mv = 0ULL;
+    int score = p->len;
+
+    for (int j = 0; j < m; j++) {
+        // Top row of a global alignment grows by one per column (hin = +1)
+        score += advance_block(&Pv, &Mv, peq[t[j]], 1, last);
+        // Each remaining column can lower the score by at most one
+        if (score - (m - 1 - j) > bound) return bound + 1;
+    }
+    return score;
+}
+
+/* Blocked path: patterns longer than one word. */
+static int myers_blocked(const ed_pattern_t *p, const unsigned char *t, int m, int bound) {
+    const uint64_t *peq = p->peq;
+    int blocks = p->blocks;
+    uint64_t last = 1ULL << ((p->len - 1) % ED_WORD_BITS);
+
+    uint64_t stackState[2 * ED_STACK_BLOCKS];
+    uint64_t *Pv = stackState;
+    if (blocks > ED_STACK_BLOCKS) {
+        Pv = malloc(2 * (size_t)blocks * sizeof *Pv);
+        assert(Pv);
+    }
+    uint64_t *Mv = Pv + blocks;
+    for (int b = 0; b < blocks; b++) { Pv[b] = ~0ULL; Mv[b] = 0ULL; }
+
+    int score = p->len;
+    for (int j = 0; j < m; j++) {
+        const uint64_t *eq = peq + (size_t)t[j] * blocks;
+        int h = 1;
+        for (int b = 0; b < blocks - 1; b++) {
+            h = advance_block(&Pv[b], &Mv[b], eq[b], h, HIGH_BIT);
+        }
+        score += advance_block(&Pv[blocks - 1], &Mv[blocks - 1], eq[blocks - 1], h, last);
+        if (score - (m - 1 - j) > bound) { score = bound + 1; break; }
+    }
+
+    if (Pv != stackState) free(Pv);
+    return score;
+}
+
+int ed_distance_bounded(const ed_pattern_t *p, const char *text, int m, int bound) {
+    assert(p && m >= 0 && (text || m == 0));
+    int n = p->len;
+    if (bound < 0) return bound + 1;                    // No distance fits
+    if (n - m > bound || m - n > bound) return bound + 1;
+    if (n == 0) return m;
+    if (m == 0) return n;
+
+    const unsigned char *t = (const unsigned char *)text;
+    return p->blocks == 1 ? myers_single(p, t, m, bound)
+                          : myers_blocked(p, t, m, bound);
+}
+
+int ed_distance(const ed_pattern_t *p, const char *text, int m) {
+    int most = p->len > m ? p->len : m;                 // Distance never exceeds this
+    return ed_distance_bounded(p, text, m, most);
+}
+
+/* ---------- Multi-candidate kernels ---------- */
+
+#ifdef ED_X86
+
+/* Four candidates per 256-bit register, one 64-bit lane each. */
+__attribute__((target("avx2")))
+static void batch_avx2(const ed_pattern_t *p, const unsigned char *const t[],
+                       const int lens[], int out[]) {
+    int maxlen = 0;
+    for (int k = 0; k < 4; k++) {
+        if (lens[k] > maxlen) maxlen = lens[k];
+        if (lens[k] == 0) out[k] = p->len;
+    }
+
+    const __m256i all  = _mm256_set1_epi64x(-1);
+    const __m256i one  = _mm256_set1_epi64x(1);
+    const __m256i last = _mm256_set1_epi64x((long long)(1ULL << (p->len - 1)));
+    const __m128i shift = _mm_cvtsi32_si128(p->len - 1);
+    __m256i Pv = all, Mv = _mm256_setzero_si256();
+    __m256i score = _mm256_set1_epi64x(p->len);
+
+    for (int j = 0; j < maxlen; j++) {
+        uint64_t e[4];
+        for (int k = 0; k < 4; k++) e[k] = j < lens[k] ? p->single[t[k][j]] : 0ULL;
+        __m256i Eq = _mm256_loadu_si256((const __m256i *)e);
+
+        __m256i Xv = _mm256_or_si256(Eq, Mv);
+        __m256i Xh = _mm256_or_si256(_mm256_xor_si256(
+                         _mm256_add_epi64(_mm256_and_si256(Eq, Pv), Pv), Pv), Eq);
+        __m256i Ph = _mm256_or_si256(Mv, _mm256_andnot_si256(_mm256_or_si256(Xh, Pv), all));
+        __m256i Mh = _mm256_and_si256(Pv, Xh);
+
+        score = _mm256_add_epi64(score, _mm256_srl_epi64(_mm256_and_si256(Ph, last), shift));
+        score = _mm256_sub_epi64(score, _mm256_srl_epi64(_mm256_and_si256(Mh, last), shift));
+
+        Ph = _mm256_or_si256(_mm256_slli_epi64(Ph, 1), one);
+        Mh = _mm256_slli_epi64(Mh, 1);
+        Pv = _mm256_or_si256(Mh, _mm256_andnot_si256(_mm256_or_si256(Xv, Ph), all));
+        Mv = _mm256_and_si256(Ph, Xv);
+
+        // Lanes whose text ends here are final; later columns are ignored
+        if (j + 1 == lens[0] || j + 1 == lens[1] || j + 1 == lens[2] || j + 1 == lens[3]) {
+            int64_t s[4];
+            _mm256_storeu_si256((__m256i *)s, score);
+            for (int k = 0; k < 4; k++) if (j + 1 == lens[k]) out[k] = (int)s[k];
+        }
+    }
+}
+
+/* Two candidates per 128-bit register (baseline x86-64). */
+static void batch_sse2(const ed_pattern_t *p, const unsigned char *const t[],
+                       const int lens[], int out[]) {
+    int maxlen = lens[0] > lens[1] ? lens[0] : lens[1];
+    for (int k = 0; k < 2; k++) if (lens[k] == 0) out[k] = p->len;
+
+    const __m128i all  = _mm_set1_epi64x(-1);
+    const __m128i one  = _mm_set1_epi64x(1);
+    const __m128i last = _mm_set1_epi64x((long long)(1ULL << (p->len - 1)));
+    const __m128i shift = _mm_cvtsi32_si128(p->len - 1);
+    __m128i Pv = all, Mv = _mm_setzero_si128();
+    __m128i score = _mm_set1_epi64x(p->len);
+
+    for (int j = 0; j < maxlen; j++) {
+        uint64_t e[2];
+        for (int k = 0; k < 2; k++) e[k] = j < lens[k] ? p->single[t[k][j]] : 0ULL;
+        __m128i Eq = _mm_loadu_si128((const __m128i *)e);
+
+        __m128i Xv = _mm_or_si128(Eq, Mv);
+        __m128i Xh = _mm_or_si128(_mm_xor_si128(
+                         _mm_add_epi64(_mm_and_si128(Eq, Pv), Pv), Pv), Eq);
+        __m128i Ph = _mm_or_si128(Mv, _mm_andnot_si128(_mm_or_si128(Xh, Pv), all));
+        __m128i Mh = _mm_and_si128(Pv, Xh);
+
+        score = _mm_add_epi64(score, _mm_srl_epi64(_mm_and_si128(Ph, last), shift));
+        score = _mm_sub_epi64(score, _mm_srl_epi64(_mm_and_si128(Mh, last), shift));
+
+        Ph = _mm_or_si128(_mm_slli_epi64(Ph, 1), one);
+        Mh = _mm_slli_epi64(Mh, 1);
+        Pv = _mm_or_si128(Mh, _mm_andnot_si128(_mm_or_si128(Xv, Ph), all));
+        Mv = _mm_and_si128(Ph, Xv);
+
+        if (j + 1 == lens[0] || j + 1 == lens[1]) {
+            int64_t s[2];
+            _mm_storeu_si128((__m128i *)s, score);
+            for (int k = 0; k < 2; k++) if (j + 1 == lens[k]) out[k] = (int)s[k];
+        }
+    }
+}
+
+/* 1 if the CPU supports AVX2 (checked once) */
+static int have_avx2(void) {
+    static int cached = -1;
+    if (cached < 0) {
+        __builtin_cpu_init();
+        cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return cached;
+}
+
+#endif /* ED_X86 */
+
+void ed_distance_batch(const ed_pattern_t *p, const char *const texts[],
+                       const int lens[], int k, int out[]) {
+    assert(p && k >= 0 && k <= ED_BATCH);
+
+#ifdef ED_X86
+    if (p->blocks == 1 && p->len > 0 && k > 1) {
+        // Pad unused lanes with empty texts
+        const unsigned char *t[ED_BATCH];
+        int l[ED_BATCH], o[ED_BATCH];
+        for (int i = 0; i < ED_BATCH; i++) {
+            t[i] = (const unsigned char *)(i < k ? texts[i] : "");
+            l[i] = i < k ? lens[i] : 0;
+        }
+        if (have_avx2()) {
+            batch_avx2(p, t, l, o);
+        } else {
+            batch_sse2(p, t, l, o);
+            if (k > 2) batch_sse2(p, t + 2, l + 2, o + 2);
+        }
+        for (int i = 0; i < k; i++) out[i] = o[i];
+        return;
+    }
+#endif
+
+    for (int i = 0; i < k; i++) out[i] = ed_distance(p, texts[i], lens[i]);
+}
@@ -0,0 +1,326 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "exec.h"
+#include "print.h"
+#include "utils.h"
+#include "metrics.h"
+
+// Longest query line read in one piece (matches the sequential driver)
+#define QUERY_LEN 1024
+// Queries handed to a worker at a time
+#define CHUNK_QUERIES 64
+// Chunks read before workers start (one batch)
+#define BATCH_CHUNKS 64
+
+/* Output produced for one chunk of queries; the buffers are reused by
+   every batch */
+typedef struct chunk_out {
+    out_buf_t out;                      // Text for the output file
+    out_buf_t sum;                      // Summary lines
+} chunk_out_t;
+
+/* Shared state of the worker pool and the batch it is answering */
+typedef struct batch {
+    char            (*queries)[QUERY_LEN];
+    int              count;             // Queries in this batch
+    chunk_out_t      chunks[BATCH_CHUNKS];
+    int              next_chunk;        // Next chunk to hand out
+    pthread_mutex_t  lock;              // Guards the fields below and next_chunk
+    pthread_cond_t   work;              // A new batch is posted, or stop is set
+    pthread_cond_t   done;              // The last busy worker finished
+    unsigned         generation;        // Batches posted so far
+    int              busy;              // Workers still on the current batch
+    int              stop;              // Workers exit
+    query_fn         fn;
+    void            *index;
+    const row_source_t *src;
+    int              quiet;             // No summary lines
+} batch_t;
+
+/* EZI_ADD of row id in src */
+static const char *row_key(const row_source_t *src, row_id_t id) {
+    if (src->store) return colstore_field(src->store, id, ROW_FIELD_EZI_ADD);
+    return src->rows[id].EZI_ADD;
+}
+
+/* With distances, each key's rows are headed by "distance D: KEY" */
+static void write_distance(out_buf_t *out, const row_source_t *src,
+                           const search_stats_t *st, unsigned int i) {
+    const char *key = row_key(src, st->results[i]);
+    if (i > 0 && st->distances[i] == st->distances[i - 1] &&
+        strcmp(key, row_key(src, st->results[i - 1])) == 0) return;
+    char line[32];
+    int n = snprintf(line, sizeof(line), "distance %d: ", st->distances[i]);
+    out_put(out, line, (size_t)n);
+    out_puts(out, key);
+    out_put(out, "\n", 1);
+}
+
+void write_query_result(out_buf_t *out, out_buf_t *summary, const row_source_t *src,
+                        const char *q, const search_stats_t *st) {
+    // write results to output file
+    out_puts(out, q);
+    if (st->result_count == 0) {
+        out_put(out, "\nNOTFOUND\n", 10);
+    } else {
+        out_put(out, "\n", 1);
+        for (unsigned int i = 0; i < st->result_count; i++) {
+            if (st->distances) write_distance(out, src, st, i);
+            format_row(out, src, st->results[i]);
+        }
+    }
+
+    // print summary
+    if (!summary) return;
+    char line[128];
+    out_puts(summary, q);
+    int n = snprintf(line, sizeof(line), " --> %u records found - comparisons: b%llu n%u s%u\n",
+                     st->result_count,
+                     (unsigned long long)st->bit_comparisons,
+                     st->node_comparisons, st->string_comparisons);
+    out_put(summary, line, (size_t)n);
+}
+
+/* Set up b to write to f directly through its descriptor (anything f
+   still buffers goes first); streams without one are written with fwrite.
+   With no f, b only collects in memory. */
+static void out_open(out_buf_t *b, FILE *f) {
+    if (!f) {
+        out_init(b, -1, NULL);
+        return;
+    }
+    fflush(f);
+    int fd = fileno(f);
+    out_init(b, fd, fd >= 0 ? NULL : f);
+}
+
+/* Answer q with fn, adding its latency and counters to h when metrics
+   are on */
+static void answer(query_fn fn, void *index, const char *q, search_stats_t *st,
+                   query_hist_t *h) {
+    if (!metrics_enabled()) {
+        fn(index, q, st);
+        return;
+    }
+    unsigned long long t0 = metrics_now_ns();
+    fn(index, q, st);
+    query_hist_add(h, metrics_now_ns() - t0, st);
+}
+
+/* Answer and format every query of chunk c into its buffers */
+static void run_chunk(batch_t *b, int c) {
+    chunk_out_t *co = &b->chunks[c];
+    co->out.len = co->sum.len = 0;
+    query_hist_t h;
+    if (metrics_enabled()) query_hist_init(&h);
+
+    int end = (c + 1) * CHUNK_QUERIES;
+    if (end > b->count) end = b->count;
+    for (int i = c * CHUNK_QUERIES; i < end; i++) {
+        search_stats_t st;
+        answer(b->fn, b->index, b->queries[i], &st, &h);
+        write_query_result(&co->out, b->quiet ? NULL : &co->sum, b->src,
+                           b->queries[i], &st);
+        free(st.results);
+        free(st.distances);
+    }
+    metrics_add_queries(&h);
+}
+
+/* Take chunks until the batch is exhausted */
+static void work_chunks(batch_t *b) {
+    int nchunks = (b->count + CHUNK_QUERIES - 1) / CHUNK_QUERIES;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int c = b->next_chunk++;
+        pthread_mutex_unlock(&b->lock);
+        if (c >= nchunks) return;
+        run_chunk(b, c);
+    }
+}
+
+/* Pool thread: sleep until a batch is posted, help answer it, report
+   back; repeat until stop */
+static void *worker(void *arg) {
+    batch_t *b = arg;
+    unsigned seen = 0;
+    pthread_mutex_lock(&b->lock);
+    for (;;) {
+        while (b->generation == seen && !b->stop) pthread_cond_wait(&b->work, &b->lock);
+        if (b->stop) break;
+        seen = b->generation;
+        pthread_mutex_unlock(&b->lock);
+        work_chunks(b);
+        pthread_mutex_lock(&b->lock);
+        if (--b->busy == 0) pthread_cond_signal(&b->done);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+/* Write the n chunk buffers at bufs[0], bufs[step], ... to sink in order,
+   in one writev call where the sink is a descriptor */
+static void emit_chunks(const out_buf_t *sink, out_buf_t *bufs, size_t step, int n) {
+    phase_mark_t mark = phase_begin();
+    if (sink->fd < 0) {
+        for (int c = 0; c < n; c++) {
+            out_buf_t *o = (out_buf_t *)((char *)bufs + c * step);
+            fwrite(o->data, 1, o->len, sink->fp);
+        }
+        phase_end(PHASE_WRITE, mark);
+        return;
+    }
+    struct iovec iov[BATCH_CHUNKS];
+    int niov = 0;
+    for (int c = 0; c < n; c++) {
+        out_buf_t *o = (out_buf_t *)((char *)bufs + c * step);
+        if (o->len == 0) continue;
+        iov[niov].iov_base = o->data;
+        iov[niov].iov_len = o->len;
+        niov++;
+    }
+    struct iovec *v = iov;
+    while (niov > 0) {
+        ssize_t w = writev(sink->fd, v, niov);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;                  // Sink failed; drop the rest
+        // Skip what was written, possibly part of an iovec
+        while (niov > 0 && (size_t)w >= v->iov_len) {
+            w -= (ssize_t)v->iov_len;
+            v++;
+            niov--;
+        }
+        if (niov > 0) {
+            v->iov_base = (char *)v->iov_base + w;
+            v->iov_len -= (size_t)w;
+        }
+    }
+    phase_end(PHASE_WRITE, mark);
+}
+
+/* Sequential path: answer each query as it is read */
+static void run_inline(FILE *in, FILE *fout, FILE *summary,
+                       query_fn fn, void *index, const row_source_t *src) {
+    out_buf_t out, sum;
+    out_open(&out, fout);
+    out_open(&sum, summary);
+
+    query_hist_t h;
+    if (metrics_enabled()) query_hist_init(&h);
+
+    char q[QUERY_LEN];
+    while (fgets(q, sizeof(q), in)) {
+        strip_newline(q);
+
+        search_stats_t st;
+        answer(fn, index, q, &st, &h);
+        write_query_result(&out, summary ? &sum : NULL, src, q, &st);
+        out_maybe_flush(&out);
+        out_maybe_flush(&sum);
+
+        free(st.results);
+        free(st.distances);
+    }
+    metrics_add_queries(&h);
+    out_free(&out);
+    out_free(&sum);
+}
+
+void run_queries(FILE *in, FILE *fout, FILE *summary, query_fn fn,
+                 void *index, const row_source_t *src, int nthreads) {
+    phase_mark_t mark = phase_begin();
+    if (nthreads <= 1) {
+        run_inline(in, fout, summary, fn, index, src);
+        phase_end(PHASE_QUERY, mark);
+        return;
+    }
+
+    batch_t b;
+    b.queries = malloc((size_t)BATCH_CHUNKS * CHUNK_QUERIES * sizeof(*b.queries));
+    assert(b.queries);
+    b.fn = fn;
+    b.index = index;
+    b.src = src;
+    b.quiet = summary == NULL;
+    for (int c = 0; c < BATCH_CHUNKS; c++) {
+        out_init(&b.chunks[c].out, -1, NULL);
+        out_init(&b.chunks[c].sum, -1, NULL);
+    }
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.work, NULL);
+    pthread_cond_init(&b.done, NULL);
+    b.generation = 0;
+    b.busy = 0;
+    b.stop = 0;
+
+    // Start the pool once. Threads that fail to start are simply missing:
+    // the calling thread answers every batch too, so with none started
+    // the queries are answered on it alone.
+    pthread_t *tid = malloc((size_t)nthreads * sizeof(*tid));
+    assert(tid);
+    int started = 0;
+    for (int w = 1; w < nthreads; w++) {
+        if (pthread_create(&tid[started], NULL, worker, &b) == 0) started++;
+    }
+
+    out_buf_t out, sum;
+    out_open(&out, fout);
+    out_open(&sum, summary);
+
+    for (;;) {
+        // Read one batch of queries
+        b.count = 0;
+        while (b.count < BATCH_CHUNKS * CHUNK_QUERIES &&
+               fgets(b.queries[b.count], QUERY_LEN, in)) {
+            strip_newline(b.queries[b.count]);
+            b.count++;
+        }
+        if (b.count == 0) break;
+
+        // Post it to the pool and work on it too, then wait for the
+        // workers still answering chunks
+        pthread_mutex_lock(&b.lock);
+        b.next_chunk = 0;
+        b.busy = started;
+        b.generation++;
+        pthread_cond_broadcast(&b.work);
+        pthread_mutex_unlock(&b.lock);
+        work_chunks(&b);
+        pthread_mutex_lock(&b.lock);
+        while (b.busy > 0) pthread_cond_wait(&b.done, &b.lock);
+        pthread_mutex_unlock(&b.lock);
+
+        // Emit chunks in input order
+        int nchunks = (b.count + CHUNK_QUERIES - 1) / CHUNK_QUERIES;
+        emit_chunks(&out, &b.chunks[0].out, sizeof(chunk_out_t), nchunks);
+        if (summary) emit_chunks(&sum, &b.chunks[0].sum, sizeof(chunk_out_t), nchunks);
+        if (b.count < BATCH_CHUNKS * CHUNK_QUERIES) break;   // Input exhausted
+    }
+
+    pthread_mutex_lock(&b.lock);
+    b.stop = 1;
+    pthread_cond_broadcast(&b.work);
+    pthread_mutex_unlock(&b.lock);
+    for (int w = 0; w < started; w++) pthread_join(tid[w], NULL);
+
+    for (int c = 0; c < BATCH_CHUNKS; c++) {
+        free(b.chunks[c].out.data);
+        free(b.chunks[c].sum.data);
+    }
+    out_free(&out);
+    out_free(&sum);
+    pthread_cond_destroy(&b.done);
+    pthread_cond_destroy(&b.work);
+    pthread_mutex_destroy(&b.lock);
+    free(tid);
+    free(b.queries);
+    phase_end(PHASE_QUERY, mark);
+}
@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashindex.h"
+
+/* Keep the table at most half full so probe runs stay short */
+#define HASH_MAX_LOAD_NUM 1
+#define HASH_MAX_LOAD_DEN 2
+
+/* One distinct key; its row ids are rows[first .. first + count) */
+typedef struct hash_entry {
+    const char *key;
+    uint32_t    first;
+    uint32_t    count;
+} hash_entry_t;
+
+/* Probing only touches tags[], a dense array of 32-bit hashes (16 per
+   cache line); an entry is read only when its tag matches. Tag 0 marks an
+   empty slot. */
+struct hash_index {
+    uint32_t     *tags;
+    hash_entry_t *entries;
+    size_t        mask;         /* capacity - 1 (capacity is a power of 2) */
+    row_id_t     *rows;         /* all row ids, grouped by key */
+    size_t        row_count;
+};
+
+/* FNV-1a with a final avalanche so low bits are usable as a slot index */
+static uint32_t hash_key(const char *s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    uint32_t tag = (uint32_t)h;
+    return tag ? tag : 1U;
+}
+
+/* Slot holding key, or the empty slot where it belongs */
+static size_t find_slot(const hash_index_t *h, const char *key, uint32_t tag) {
+    size_t i = tag & h->mask;
+    while (h->tags[i] != 0U) {
+        if (h->tags[i] == tag && strcmp(h->entries[i].key, key) == 0) break;
+        i = (i + 1) & h->mask;
+    }
+    return i;
+}
+
+hash_index_t *create_hash_index(const char *const keys[], size_t count) {
+    hash_index_t *h = calloc(1, sizeof *h);
+    if (!h) return NULL;
+
+    size_t n = 0;
+    for (size_t id = 0; id < count; id++)
+        if (keys[id]) n++;
+
+    size_t cap = 16;
+    while (cap * HASH_MAX_LOAD_NUM < n * HASH_MAX_LOAD_DEN) cap <<= 1;
+    h->mask = cap - 1;
+    h->tags = calloc(cap, sizeof *h->tags);
+    h->entries = calloc(cap, sizeof *h->entries);
+    h->rows = malloc((n ? n : 1) * sizeof *h->rows);
+    if (!h->tags || !h->entries || !h->rows) {
+        free_hash_index(h);
+        return NULL;
+    }
+
+    // Pass 1: distinct keys and their row counts
+    for (size_t id = 0; id < count; id++) {
+        const char *key = keys[id];
+        if (!key) continue;
+        uint32_t tag = hash_key(key);
+        size_t i = find_slot(h, key, tag);
+        if (h->tags[i] == 0U) {
+            h->tags[i] = tag;
+            h->entries[i].key = key;
+        }
+        h->entries[i].count++;
+    }
+
+    // Assign each key its range of rows
+    uint32_t next = 0;
+    for (size_t i = 0; i <= h->mask; ++i) {
+        if (h->tags[i] == 0U) continue;
+        h->entries[i].first = next;
+        next += h->entries[i].count;
+        h->entries[i].count = 0;
+    }
+
+    // Pass 2: place rows, keeping file order within each key
+    for (size_t id = 0; id < count; id++) {
+        const char *key = keys[id];
+        if (!key) continue;
+        hash_entry_t *e = &h->entries[find_slot(h, key, hash_key(key))];
+        h->rows[e->first + e->count++] = (row_id_t)id;
+    }
+    h->row_count = n;
+    return h;
+}
+
+void free_hash_index(hash_index_t *h) {
+    if (!h) return;
+    free(h->tags);
+    free(h->entries);
+    free(h->rows);
+    free(h);
+}
+
+void search_hash_index(const hash_index_t *h, const char *query,
+                       search_stats_t *out) {
+    out->results = NULL;
+    out->result_count = 0U;
+    out->capacity = 0U;
+    out->bit_comparisons = 0ULL;
+    out->node_comparisons = 0U;
+    out->string_comparisons = 0U;
+    out->distances = NULL;
+    if (!h) return;
+
+    uint32_t tag = hash_key(query);
+    size_t i = tag & h->mask;
+    for (;;) {
+        out->node_comparisons++;            // Count slot probe
+        if (h->tags[i] == 0U) return;       // Empty slot: not present
+        if (h->tags[i] == tag) {
+            out->string_comparisons++;
+            const hash_entry_t *e = &h->entries[i];
+            if (strcmp_bits_firstdiff(query, e->key, &out->bit_comparisons) == 0) {
+                for (uint32_t r = 0; r < e->count; ++r)
+                    push_result(out, h->rows[e->first + r]);
+                return;
+            }
+        }
+        i = (i + 1) & h->mask;
+    }
+}
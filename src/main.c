@@ -5,19 +5,57 @@
 #include <time.h>
 
 #include "read.h"
-#include "list.h"
 #include "search.h"
 #include "print.h"
 #include "utils.h"
+#include "exec.h"
+#include "qcache.h"
+#include "hashindex.h"
+#include "colstore.h"
+#include "spatial.h"
+#include "metrics.h"
 
 
 #ifdef ENABLE_PATRICIA
 #include "patricia.h"
+#include "snapshot.h"
+#include "delta.h"
+#include "art.h"
 #endif
 
 /* show correct program usage */
 static void usage(const char *prog){
-    fprintf(stderr, "Usage: %s <stage> <input.csv> <output.txt>\n", prog);
+    fprintf(stderr, "Usage: %s [-j N] [-c] [-q] [--cache=MB] [--metrics=json] [--prefix[=N] | --range[=N]]\n"
+                    "       [--topk=K[,D]] [--delta=FILE] [--tree-stats] <stage> <input.csv> <output.txt>\n", prog);
+#ifdef ENABLE_PATRICIA
+    fprintf(stderr, "       %s snapshot <input.csv> <snapshot.bin>\n", prog);
+    fprintf(stderr, "       (<input.csv> may also be a snapshot file)\n");
+#endif
+#ifdef ENABLE_PATRICIA
+    fprintf(stderr, "  <stage>  1 = linear scan, 2 = Patricia tree, 3 = hash index (exact only),\n"
+                    "           4 = k-d tree on x/y (queries: near X Y [K] | box X0 Y0 X1 Y1 | within X Y R),\n"
+                    "           5 = adaptive radix tree\n");
+#endif
+    fprintf(stderr, "  -j N   answer queries on N threads (output order is kept); stage 2\n"
+                    "         and snapshot also build the tree on N threads\n");
+    fprintf(stderr, "  --cache=MB  remember answers of repeated queries in an LRU cache\n"
+                    "              of MB megabytes; hit/miss counts go to stderr\n");
+    fprintf(stderr, "  -q     quiet: no per-query summary lines on stdout\n");
+    fprintf(stderr, "  --metrics=json  at exit, write per-phase wall/CPU times and per-query\n"
+                    "                  latency and b/n/s histograms to stderr as JSON\n");
+#ifdef ENABLE_PATRICIA
+    fprintf(stderr, "  -c     keep rows in a columnar store (stages 2-5, CSV input)\n");
+    fprintf(stderr, "  --prefix[=N]  stage 2: treat each query as a prefix and return the\n"
+                    "                rows of all keys starting with it (at most N rows)\n");
+    fprintf(stderr, "  --range[=N]   stage 2: each query is LO<tab>HI; return the rows of all\n"
+                    "                keys in [LO, HI) in key order (at most N rows)\n");
+    fprintf(stderr, "  --topk=K[,D]  stage 2: return the rows of the K keys closest to each\n"
+                    "                query by edit distance (at most D edits away, K <= 1000)\n");
+    fprintf(stderr, "  --delta=FILE  stage 2: apply an add/delete/modify file to the built or\n"
+                    "                loaded tree before answering queries\n");
+    fprintf(stderr, "  --tree-stats  stage 2 or 5: report the tree's memory use and shape, and the\n"
+                    "                bytes held by the rows, to stderr before answering queries\n");
+#endif
     exit(1);
 }
 
@@ -25,90 +63,432 @@ static void usage(const char *prog){
  * The ENABLE_PATRICIA flag controls whether Stage 2 (Patricia tree search)
  * is compiled in. This lets the same main.c work for two builds:
  *   - dict1: no Patricia tree (stage 1 only)
- *   - dict2: includes Patricia tree (stage 1 + stage 2)
+ *   - dict2: includes Patricia tree (stage 1 + stage 2), the hash
+ *            index (stage 3) and the spatial index (stage 4)
  */
-#ifndef ENABLE_PATRICIA
-#else
 
-/* print results for Patricia tree search */
-static void print_results(FILE *out, const search_stats_t *st) {
-    if (!st || st->result_count == 0) {
-        fprintf(out, "NOTFOUND\n");
+/* command-line options given before <stage> */
+typedef struct options {
+    int jobs;                   /* query worker threads (-j N) */
+    int columnar;               /* rows in a colstore_t (-c) */
+    size_t cache_mb;            /* query result cache size, 0 = off (--cache=MB) */
+    int prefix;                 /* stage 2 prefix queries (--prefix[=N]) */
+    int range;                  /* stage 2 range queries (--range[=N]) */
+    unsigned scan_limit;        /* most rows per prefix/range query, 0 = all */
+    unsigned topk;              /* stage 2 top-k fuzzy queries, 0 = off (--topk=K) */
+    int topk_distance;          /* most edits for a top-k match (--topk=K,D) */
+    const char *delta;          /* delta file applied to the stage 2 tree (--delta=FILE) */
+    int quiet;                  /* no summary lines on stdout (-q) */
+    int metrics;                /* JSON metrics on stderr at exit (--metrics=json) */
+    int tree_stats;             /* stage 2 memory/shape report (--tree-stats) */
+} options_t;
+
+/* "" or "=N" after --prefix/--range; returns 0 if malformed */
+static int parse_scan_limit(const char *s, unsigned *limit) {
+    if (*s == '\0') return 1;
+    if (*s != '=') return 0;
+    char *end;
+    unsigned long n = strtoul(s + 1, &end, 10);
+    if (end == s + 1 || *end != '\0') return 0;
+    *limit = (unsigned)n;
+    return 1;
+}
+
+/* Largest K accepted by --topk */
+#define TOPK_MAX 1000
+
+/* "K" or "K,D" after --topk=, 1 <= K <= TOPK_MAX; returns 0 if malformed */
+static int parse_topk(const char *s, unsigned *k, int *max_distance) {
+    char *end;
+    unsigned long n = strtoul(s, &end, 10);
+    if (end == s || n == 0 || n > TOPK_MAX) return 0;
+    *k = (unsigned)n;
+    *max_distance = INT_MAX / 2;
+    if (*end == '\0') return 1;
+    if (*end != ',') return 0;
+    s = end + 1;
+    long d = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || d < 0 || d > INT_MAX / 2) return 0;
+    *max_distance = (int)d;
+    return 1;
+}
+
+/* parse leading options; returns index of the first positional argument */
+static int parse_options(int argc, char *argv[], options_t *opt) {
+    opt->jobs = 1;
+    opt->columnar = 0;
+    opt->cache_mb = 0;
+    opt->prefix = 0;
+    opt->range = 0;
+    opt->scan_limit = 0;
+    opt->topk = 0;
+    opt->topk_distance = 0;
+    opt->delta = NULL;
+    opt->quiet = 0;
+    opt->metrics = 0;
+    opt->tree_stats = 0;
+    int i = 1;
+    while (i < argc && argv[i][0] == '-' && argv[i][1] != '\0') {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            opt->jobs = atoi(argv[i + 1]);
+            if (opt->jobs < 1) usage(argv[0]);
+            i += 2;
+        } else if (strncmp(argv[i], "--cache=", 8) == 0) {
+            char *end;
+            unsigned long mb = strtoul(argv[i] + 8, &end, 10);
+            if (end == argv[i] + 8 || *end != '\0' || mb == 0) usage(argv[0]);
+            opt->cache_mb = mb;
+            i += 1;
+        } else if (strncmp(argv[i], "--prefix", 8) == 0 &&
+                   parse_scan_limit(argv[i] + 8, &opt->scan_limit)) {
+            opt->prefix = 1;
+            i += 1;
+        } else if (strncmp(argv[i], "--range", 7) == 0 &&
+                   parse_scan_limit(argv[i] + 7, &opt->scan_limit)) {
+            opt->range = 1;
+            i += 1;
+        } else if (strncmp(argv[i], "--topk=", 7) == 0 &&
+                   parse_topk(argv[i] + 7, &opt->topk, &opt->topk_distance)) {
+            i += 1;
+        } else if (strncmp(argv[i], "--delta=", 8) == 0 && argv[i][8] != '\0') {
+            opt->delta = argv[i] + 8;
+            i += 1;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            opt->columnar = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "-q") == 0) {
+            opt->quiet = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "--metrics=json") == 0) {
+            opt->metrics = 1;
+            i += 1;
+        } else if (strcmp(argv[i], "--tree-stats") == 0) {
+            opt->tree_stats = 1;
+            i += 1;
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0') {
+            opt->jobs = atoi(argv[i] + 2);
+            if (opt->jobs < 1) usage(argv[0]);
+            i += 1;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    return i;
+}
+
+/* answer stdin with fn over index, through the result cache if enabled;
+   summary lines go to stdout unless quiet */
+static void answer_queries(FILE *fout, query_fn fn, void *index,
+                           const row_source_t *src, const options_t *opt) {
+    FILE *summary = opt->quiet ? NULL : stdout;
+    if (opt->cache_mb == 0) {
+        run_queries(stdin, fout, summary, fn, index, src, opt->jobs);
         return;
     }
-    for (unsigned i = 0; i < st->result_count; ++i) {
-        print_record(out, st->results[i]);
+    query_cache_t *cache = create_query_cache(fn, index, opt->cache_mb << 20);
+    if (!cache) {
+        fprintf(stderr, "Error: could not create query cache\n");
+        return;
     }
+    run_queries(stdin, fout, summary, cached_search, cache, src, opt->jobs);
+    query_cache_report(cache, stderr);
+    free_query_cache(cache);
+}
+
+/* stage 1 query: linear scan of the list */
+static void stage1_search(void *index, const char *q, search_stats_t *st) {
+    search_by_ezi_add((node_t *)index, q, st);
 }
-#endif
 
 /* stage 1: search using linked list */
-static void run_stage1(node_t *list, FILE *fout) {
-    char q[1024];
-    while (fgets(q, sizeof(q), stdin)) {
-        strip_newline(q);
-
-        search_stats_t st;
-        search_by_ezi_add(list, q, &st);
-
-        // write results to output file
-        fprintf(fout, "%s\n", q);
-        if (st.result_count == 0) {
-            fprintf(fout, "NOTFOUND\n");
-        } else {
-            for (unsigned int i = 0; i < st.result_count; i++) {
-                print_record(fout, st.results[i]);
-            }
-        }
+static void run_stage1(node_t *list, FILE *fout, const row_source_t *src,
+                       const options_t *opt) {
+    answer_queries(fout, stage1_search, list, src, opt);
+}
+
+#ifdef ENABLE_PATRICIA
+
+/* stage 3 query: exact hash lookup */
+static void stage3_search(void *index, const char *q, search_stats_t *st) {
+    search_hash_index((const hash_index_t *)index, q, st);
+}
 
-        // print summary to stdout
-        printf("%s --> %u records found - comparisons: b%llu n%u s%u\n",
-               q, st.result_count,
-               (unsigned long long)st.bit_comparisons,
-               st.node_comparisons, st.string_comparisons);
+/* EZI_ADD of every row, indexed by row id (NULL where absent) */
+static const char **row_keys(const row_source_t *src, size_t count) {
+    const char **keys = malloc((count ? count : 1) * sizeof *keys);
+    if (!keys) return NULL;
+    for (size_t id = 0; id < count; id++) {
+        keys[id] = src->store
+                 ? colstore_field(src->store, (row_id_t)id, ROW_FIELD_EZI_ADD)
+                 : src->rows[id].EZI_ADD;
+    }
+    return keys;
+}
 
-        free(st.results);
+/* stage 3: search using hash index over the rows */
+static void run_stage3(const row_source_t *src, size_t count, FILE *fout,
+                       const options_t *opt) {
+    phase_mark_t mark = phase_begin();
+    const char **keys = row_keys(src, count);
+    hash_index_t *h = keys ? create_hash_index(keys, count) : NULL;
+    free(keys);
+    phase_end(PHASE_BUILD, mark);
+    if (!h) {
+        fprintf(stderr, "Error: could not create hash index\n");
+        return;
     }
+    answer_queries(fout, stage3_search, h, src, opt);
+    mark = phase_begin();
+    free_hash_index(h);
+    phase_end(PHASE_TEARDOWN, mark);
 }
 
-#ifdef ENABLE_PATRICIA
+/* stage 4 query: nearest / box / radius on the coordinates */
+static void stage4_search(void *index, const char *q, search_stats_t *st) {
+    search_spatial((const kd_tree_t *)index, q, st);
+}
 
-/* stage 2: search using Patricia tree */
-static void run_stage2(node_t *list, FILE *fout) {
-    patricia_tree_t *tree = create_patricia_tree();
-    if (!tree) {
+/* stage 4: search using a k-d tree over the rows' x/y */
+static void run_stage4(const row_source_t *src, size_t count, FILE *fout,
+                       const options_t *opt) {
+    phase_mark_t mark = phase_begin();
+    double *xy = malloc((count ? count : 1) * 2 * sizeof *xy);
+    kd_tree_t *t = NULL;
+    if (xy) {
+        for (size_t id = 0; id < count; id++) {
+            xy[2 * id]     = (double)(src->store ? colstore_x(src->store, (row_id_t)id)
+                                                 : src->rows[id].x);
+            xy[2 * id + 1] = (double)(src->store ? colstore_y(src->store, (row_id_t)id)
+                                                 : src->rows[id].y);
+        }
+        t = create_kd_tree(xy, count);
+    }
+    free(xy);
+    phase_end(PHASE_BUILD, mark);
+    if (!t) {
+        fprintf(stderr, "Error: could not create spatial index\n");
+        return;
+    }
+    answer_queries(fout, stage4_search, t, src, opt);
+    mark = phase_begin();
+    free_kd_tree(t);
+    phase_end(PHASE_TEARDOWN, mark);
+}
+
+/* build Patricia tree from the rows' keys (bulk load on nthreads threads,
+   same shape as inserting them in row order) */
+static patricia_tree_t *build_tree(const row_source_t *src, size_t count, int nthreads) {
+    phase_mark_t mark = phase_begin();
+    const char **keys = row_keys(src, count);
+    if (!keys) {
         fprintf(stderr, "Error: could not create Patricia tree\n");
+        return NULL;
+    }
+    patricia_tree_t *tree = patricia_bulk_load_parallel(keys, count, nthreads);
+    free(keys);
+    phase_end(PHASE_BUILD, mark);
+    return tree;
+}
+
+/* snapshot mode: parse CSV, build tree, write both to a snapshot file */
+static int run_snapshot(const char *input_csv, const char *snapshot_path, int nthreads) {
+    csv_arena_t arena;
+    node_t *list = read_csv_arena(input_csv, &arena);
+    if (!list) {
+        fprintf(stderr, "Error: failed to read CSV or file is empty\n");
+        return 1;
+    }
+
+    row_source_t src = { arena.rows, NULL };
+    patricia_tree_t *tree = build_tree(&src, arena.count, nthreads);
+    phase_mark_t mark = phase_begin();
+    int rc = tree ? snapshot_write(snapshot_path, arena.rows, arena.count, tree) : -1;
+    if (rc != 0) fprintf(stderr, "Error: failed to write snapshot %s\n", snapshot_path);
+    phase_end(PHASE_WRITE, mark);
+
+    mark = phase_begin();
+    free_patricia_tree(tree);
+    free_csv_arena(&arena);
+    phase_end(PHASE_TEARDOWN, mark);
+    return rc == 0 ? 0 : 1;
+}
+
+/* stage 2 query: Patricia descent with fuzzy fallback */
+static void stage2_search(void *index, const char *q, search_stats_t *st) {
+    search_patricia((patricia_tree_t *)index, q, st);
+}
+
+/* stage 2 in prefix/range mode: the tree and the row limit */
+typedef struct scan_index {
+    patricia_tree_t *tree;
+    unsigned         limit;
+} scan_index_t;
+
+/* stage 2 prefix query: rows of every key starting with q */
+static void stage2_prefix_search(void *index, const char *q, search_stats_t *st) {
+    scan_index_t *p = index;
+    search_patricia_prefix(p->tree, q, p->limit, st);
+}
+
+/* stage 2 range query "LO<tab>HI": rows of every key in [LO, HI); without
+   a tab, every key from LO on */
+static void stage2_range_search(void *index, const char *q, search_stats_t *st) {
+    scan_index_t *p = index;
+    const char *tab = strchr(q, '\t');
+    if (!tab) {
+        search_patricia_range(p->tree, q, NULL, p->limit, st);
         return;
     }
+    size_t n = (size_t)(tab - q);
+    char *lo = malloc(n + 1);
+    assert(lo);
+    memcpy(lo, q, n);
+    lo[n] = '\0';
+    search_patricia_range(p->tree, lo, tab + 1, p->limit, st);
+    free(lo);
+}
+
+/* stage 2 in top-k mode: the tree, k and the distance bound */
+typedef struct topk_index {
+    patricia_tree_t *tree;
+    unsigned         k;
+    int              max_distance;
+} topk_index_t;
 
-    // build Patricia tree from list of rows
-    for (node_t *cur = list; cur; cur = cur->next) {
-        if (cur->data && cur->data->EZI_ADD) {
-            insert_into_patricia(tree, cur->data->EZI_ADD, cur->data);
+/* stage 2 top-k query: rows of the k closest keys, closest first, each
+   row tagged with its key's edit distance (no rows if out of memory) */
+static void stage2_topk_search(void *index, const char *q, search_stats_t *st) {
+    topk_index_t *p = index;
+    fuzzy_match_t *matches = malloc(p->k * sizeof *matches);
+    if (!matches) {
+        memset(st, 0, sizeof *st);
+        return;
+    }
+    unsigned n = search_patricia_topk(p->tree, q, p->k, p->max_distance, matches, st);
+    if (st->result_count) st->distances = malloc(st->result_count * sizeof *st->distances);
+    if (st->distances) {
+        for (unsigned m = 0; m < n; m++) {
+            for (unsigned r = 0; r < matches[m].count; r++) {
+                st->distances[matches[m].first + r] = matches[m].distance;
+            }
         }
     }
+    free(matches);
+}
 
-    char q[1024];
-    while (fgets(q, sizeof(q), stdin)) {
-        strip_newline(q);
+/* stage 5 query: adaptive radix tree descent with fuzzy fallback */
+static void stage5_search(void *index, const char *q, search_stats_t *st) {
+    search_art((const art_tree_t *)index, q, st);
+}
 
-        search_stats_t st;
-        search_patricia(tree, q, &st);
+/* bytes of the heap-owned fields of rows [from, to) (rows added by a delta) */
+static size_t owned_field_bytes(row_t *rows, size_t from, size_t to) {
+    size_t bytes = 0;
+    for (size_t i = from; i < to; i++) {
+        char **fields[ROW_STR_FIELDS];
+        row_fields(&rows[i], fields);
+        for (int f = 0; f < ROW_STR_FIELDS; f++) {
+            if (*fields[f]) bytes += strlen(*fields[f]) + 1;
+        }
+    }
+    return bytes;
+}
 
-        // write results to output file
-        fprintf(fout, "%s\n", q);
-        print_results(fout, &st);
+/* --tree-stats: what the rows behind the tree hold (row array, list nodes
+   and the file they point into) */
+static void report_row_bytes(const csv_arena_t *arena, size_t count,
+                             const snapshot_t *snap, const colstore_t *store) {
+    if (store) {
+        fprintf(stderr, "Rows: %zu in a columnar store, %zu bytes\n",
+                count, colstore_bytes(store));
+        return;
+    }
+    size_t row_bytes  = count * sizeof(row_t);
+    size_t node_bytes = (snap->map ? snap->count : arena->count) * sizeof(node_t);
+    size_t file_bytes = snap->map ? snap->len : arena->len + (arena->tail ? strlen(arena->tail) + 1 : 0);
+    size_t added      = snap->map ? owned_field_bytes(snap->rows, snap->count, count)
+                                  : owned_field_bytes(arena->rows, arena->count, count);
+    fprintf(stderr, "Rows: %zu, %zu bytes\n", count, row_bytes + node_bytes + file_bytes + added);
+    fprintf(stderr, "    row_t array   %12zu\n", row_bytes);
+    fprintf(stderr, "    list nodes    %12zu\n", node_bytes);
+    fprintf(stderr, "    %s %12zu\n", snap->map ? "snapshot file" : "CSV buffer   ", file_bytes);
+    if (added) fprintf(stderr, "    delta fields  %12zu\n", added);
+}
+
+/* --tree-stats: the tree's memory and shape, then the rows */
+static void report_tree_stats(const patricia_tree_t *tree, const csv_arena_t *arena,
+                              size_t count, const snapshot_t *snap,
+                              const colstore_t *store) {
+    patricia_stats_t st;
+    if (patricia_get_stats(tree, &st) != 0) {
+        fprintf(stderr, "Error: could not collect tree statistics\n");
+        return;
+    }
+    patricia_print_stats(&st, stderr);
+    report_row_bytes(arena, count, snap, store);
+}
 
-        // print summary to stdout
-        printf("%s --> %u records found - comparisons: b%llu n%u s%u\n",
-               q, st.result_count,
-               (unsigned long long)st.bit_comparisons,
-               st.node_comparisons, st.string_comparisons);
+/* stage 5: search using an adaptive radix tree over the rows' keys,
+   inserted in row order */
+static void run_stage5(const row_source_t *src, size_t count, FILE *fout,
+                       const options_t *opt, const csv_arena_t *arena,
+                       const snapshot_t *snap) {
+    phase_mark_t mark = phase_begin();
+    const char **keys = row_keys(src, count);
+    if (!keys) {
+        fprintf(stderr, "Error: could not create radix tree\n");
+        return;
+    }
+    art_tree_t *t = create_art_tree();
+    for (size_t id = 0; id < count; id++) {
+        if (keys[id]) insert_into_art(t, keys[id], (row_id_t)id);
+    }
+    free(keys);
+    phase_end(PHASE_BUILD, mark);
 
-        free(st.results);
+    if (opt->tree_stats) {
+        art_stats_t st;
+        art_get_stats(t, &st);
+        art_print_stats(&st, stderr);
+        report_row_bytes(arena, count, snap, src->store);
     }
+    answer_queries(fout, stage5_search, t, src, opt);
+    mark = phase_begin();
+    free_art_tree(t);
+    phase_end(PHASE_TEARDOWN, mark);
+}
 
-    free_patricia_tree(tree);
+/* --delta: apply the change file to tree, whose row ids index the *count
+   rows at *rows; added rows are appended there, so the array may move */
+static void apply_delta_file(const char *path, patricia_tree_t *tree, row_t **rows,
+                             size_t *count) {
+    phase_mark_t mark = phase_begin();
+    delta_stats_t ds;
+    if (apply_delta(path, tree, rows, count, &ds) != 0) {
+        fprintf(stderr, "Error: failed to read delta %s\n", path);
+    } else {
+        fprintf(stderr, "Delta: %zu added, %zu deleted, %zu modified, %zu rejected\n",
+                ds.added, ds.deleted, ds.modified, ds.rejected);
+    }
+    phase_end(PHASE_BUILD, mark);
+}
+
+/* stage 2: search using Patricia tree */
+static void run_stage2(patricia_tree_t *tree, FILE *fout, const row_source_t *src,
+                       const options_t *opt) {
+    if (!tree) return;
+    if (opt->topk) {
+        topk_index_t p = { tree, opt->topk, opt->topk_distance };
+        answer_queries(fout, stage2_topk_search, &p, src, opt);
+        return;
+    }
+    if (opt->prefix || opt->range) {
+        scan_index_t p = { tree, opt->scan_limit };
+        answer_queries(fout, opt->prefix ? stage2_prefix_search : stage2_range_search,
+                       &p, src, opt);
+        return;
+    }
+    answer_queries(fout, stage2_search, tree, src, opt);
 }
 #endif
 
@@ -117,55 +497,181 @@ int main(int argc, char *argv[]) {
     
     clock_t start = clock();
 
-    if (argc != 4) usage(argv[0]);
+    options_t opt;
+    int first = parse_options(argc, argv, &opt);
+    if (argc - first != 3) usage(argv[0]);
+    const char *stage = argv[first];
+    if (opt.metrics) metrics_enable();
 
 #ifndef ENABLE_PATRICIA
     // If Patricia is not enabled, only stage 1 is valid
-    if (strcmp(argv[1], "1") != 0) {
+    if (strcmp(stage, "1") != 0) {
         fprintf(stderr, "This build excludes Patricia (stage 2). Use dict2.\n");
         usage(argv[0]);
     }
 #else
-    // If Patricia is enabled, allow stage 1 or stage 2
-    if (strcmp(argv[1], "1") != 0 && strcmp(argv[1], "2") != 0) {
+    if (strcmp(stage, "snapshot") == 0) {
+        int rc = run_snapshot(argv[first + 1], argv[first + 2], opt.jobs);
+        metrics_write_json(stderr);
+        return rc;
+    }
+    // If Patricia is enabled, allow stages 1 to 5
+    if (strcmp(stage, "1") != 0 && strcmp(stage, "2") != 0 && strcmp(stage, "3") != 0 &&
+        strcmp(stage, "4") != 0 && strcmp(stage, "5") != 0) {
         usage(argv[0]);
     }
 #endif
 
-    const char *input_csv  = argv[2];
-    const char *output_txt = argv[3];
+    const char *input_csv  = argv[first + 1];
+    const char *output_txt = argv[first + 2];
+
+    if ((opt.prefix + opt.range + (opt.topk > 0)) > 0 &&
+        (strcmp(stage, "2") != 0 || opt.prefix + opt.range + (opt.topk > 0) > 1)) {
+        fprintf(stderr, "--prefix, --range and --topk need stage 2 and exclude each other\n");
+        usage(argv[0]);
+    }
+    if (opt.tree_stats && strcmp(stage, "2") != 0 && strcmp(stage, "5") != 0) {
+        fprintf(stderr, "--tree-stats needs stage 2 or 5\n");
+        usage(argv[0]);
+    }
 
-    // read CSV into linked list
-    node_t *list = read_csv(input_csv);
+    csv_arena_t arena = {0};
+    node_t *list = NULL;
+    row_source_t src = { NULL, NULL };
+    size_t count = 0;
+#ifdef ENABLE_PATRICIA
+    // a snapshot already holds the rows and the built tree
+    snapshot_t snap = {0};
+    int from_snapshot = snapshot_is_file(input_csv);
+    if (opt.columnar && (from_snapshot || strcmp(stage, "1") == 0)) {
+        fprintf(stderr, "-c needs stage 2, 3, 4 or 5 and a CSV input\n");
+        usage(argv[0]);
+    }
+    if (opt.delta && (opt.columnar || strcmp(stage, "2") != 0)) {
+        fprintf(stderr, "--delta needs stage 2 and no -c\n");
+        usage(argv[0]);
+    }
+    if (from_snapshot) {
+        phase_mark_t mark = phase_begin();
+        if (snapshot_load(input_csv, &snap) != 0) {
+            fprintf(stderr, "Error: failed to load snapshot %s\n", input_csv);
+            return 1;
+        }
+        phase_end(PHASE_READ, mark);
+        list = snap.count ? snap.nodes : NULL;
+        src.rows = snap.rows;
+        count = snap.count;
+    } else
+#endif
+    {
+        // read CSV into linked list backed by a single arena
+        list = read_csv_arena(input_csv, &arena);
+        src.rows = arena.rows;
+        count = arena.count;
+    }
     if (!list) {
         fprintf(stderr, "Error: failed to read CSV or file is empty\n");
+#ifdef ENABLE_PATRICIA
+        snapshot_free(&snap);
+#endif
+        free_csv_arena(&arena);
         return 1;
     }
 
+#ifdef ENABLE_PATRICIA
+    // columnar mode: re-encode the rows, then drop the parsed file
+    colstore_t *store = NULL;
+    if (opt.columnar) {
+        phase_mark_t mark = phase_begin();
+        store = colstore_build(arena.rows, arena.count);
+        if (!store) {
+            fprintf(stderr, "Error: could not build columnar store\n");
+            free_csv_arena(&arena);
+            return 1;
+        }
+        free_csv_arena(&arena);
+        list = NULL;
+        src.rows = NULL;
+        src.store = store;
+        phase_end(PHASE_BUILD, mark);
+    }
+#endif
+
     // open output file
     FILE *fout = fopen(output_txt, "w");
     if (!fout) {
         perror("open output");
-        free_list(list);
+#ifdef ENABLE_PATRICIA
+        snapshot_free(&snap);
+        colstore_free(store);
+#endif
+        free_csv_arena(&arena);
         return 1;
     }
 
 #ifndef ENABLE_PATRICIA
-    run_stage1(list, fout);
+    (void)count;                // only the indexed stages need the row count
+    run_stage1(list, fout, &src, &opt);
 #else
-    if (strcmp(argv[1], "1") == 0) {
-        run_stage1(list, fout);
+    if (strcmp(stage, "1") == 0) {
+        run_stage1(list, fout, &src, &opt);
+    } else if (strcmp(stage, "3") == 0) {
+        run_stage3(&src, count, fout, &opt);
+    } else if (strcmp(stage, "4") == 0) {
+        run_stage4(&src, count, fout, &opt);
+    } else if (strcmp(stage, "5") == 0) {
+        run_stage5(&src, count, fout, &opt, &arena, &snap);
+    } else if (from_snapshot) {
+        patricia_tree_t *tree = snap.tree;
+        size_t delta_from = count;
+        if (opt.delta) {
+            // the mapped tree is read-only: edit a copy of it; added rows
+            // go after the snapshot's rows
+            phase_mark_t mark = phase_begin();
+            tree = patricia_thaw(snap.tree);
+            phase_end(PHASE_BUILD, mark);
+            apply_delta_file(opt.delta, tree, &snap.rows, &count);
+            src.rows = snap.rows;
+        }
+        if (opt.tree_stats) report_tree_stats(tree, &arena, count, &snap, NULL);
+        run_stage2(tree, fout, &src, &opt);
+        if (opt.delta) {
+            phase_mark_t mark = phase_begin();
+            free_patricia_tree(tree);
+            free_delta_rows(snap.rows, delta_from, count);
+            phase_end(PHASE_TEARDOWN, mark);
+        }
     } else {
-        run_stage2(list, fout);
+        patricia_tree_t *tree = build_tree(&src, count, opt.jobs);
+        size_t delta_from = count;      // rows appended by the delta start here
+        if (tree && opt.delta) {
+            // added rows are appended to the arena's row array, which may
+            // move; only the tree refers to rows from here on
+            apply_delta_file(opt.delta, tree, &arena.rows, &count);
+            src.rows = arena.rows;
+        }
+        if (tree && opt.tree_stats) report_tree_stats(tree, &arena, count, &snap, store);
+        run_stage2(tree, fout, &src, &opt);
+        phase_mark_t mark = phase_begin();
+        free_patricia_tree(tree);
+        if (opt.delta) free_delta_rows(arena.rows, delta_from, count);
+        phase_end(PHASE_TEARDOWN, mark);
     }
 #endif
 
+    phase_mark_t mark = phase_begin();
     fclose(fout);
-    free_list(list);
+#ifdef ENABLE_PATRICIA
+    snapshot_free(&snap);
+    colstore_free(store);
+#endif
+    free_csv_arena(&arena);
+    phase_end(PHASE_TEARDOWN, mark);
 
     clock_t end = clock();
     double cpu_time = ((double)(end - start)) / CLOCKS_PER_SEC;
     printf("CPU Time: %f seconds\n", cpu_time);
+    metrics_write_json(stderr);
 
     return 0;
 }
@@ -0,0 +1,153 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "metrics.h"
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+    "read", "parse", "build", "query", "write", "teardown"
+};
+
+static int             enabled;
+static phase_mark_t    started;                 // When metrics_enable ran
+static double          wall_total[PHASE_COUNT];
+static double          cpu_total[PHASE_COUNT];
+static query_hist_t    queries;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double clock_seconds(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void metrics_enable(void) {
+    enabled = 1;
+    query_hist_init(&queries);
+    started = phase_begin();
+}
+
+int metrics_enabled(void) {
+    return enabled;
+}
+
+phase_mark_t phase_begin(void) {
+    phase_mark_t m = { 0.0, 0.0 };
+    if (!enabled) return m;
+    m.wall = clock_seconds(CLOCK_MONOTONIC);
+    m.cpu  = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    return m;
+}
+
+void phase_end(phase_t phase, phase_mark_t mark) {
+    if (!enabled) return;
+    phase_mark_t now = phase_begin();
+    pthread_mutex_lock(&lock);
+    wall_total[phase] += now.wall - mark.wall;
+    cpu_total[phase]  += now.cpu - mark.cpu;
+    pthread_mutex_unlock(&lock);
+}
+
+unsigned long long metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+/* ---------- Histograms ---------- */
+
+static void hist_add(hist_t *h, unsigned long long v) {
+    int k = 0;
+    while (k < HIST_BUCKETS - 1 && (v >> k) != 0) k++;
+    h->bucket[k]++;
+    h->count++;
+    h->sum += (double)v;
+    if (v > h->max) h->max = v;
+}
+
+static void hist_merge(hist_t *into, const hist_t *h) {
+    for (int k = 0; k < HIST_BUCKETS; k++) into->bucket[k] += h->bucket[k];
+    into->count += h->count;
+    into->sum += h->sum;
+    if (h->max > into->max) into->max = h->max;
+}
+
+void query_hist_init(query_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void query_hist_add(query_hist_t *h, unsigned long long ns, const search_stats_t *st) {
+    hist_add(&h->latency_ns, ns);
+    hist_add(&h->b, st->bit_comparisons);
+    hist_add(&h->n, st->node_comparisons);
+    hist_add(&h->s, st->string_comparisons);
+}
+
+void metrics_add_queries(const query_hist_t *h) {
+    if (!enabled) return;
+    pthread_mutex_lock(&lock);
+    hist_merge(&queries.latency_ns, &h->latency_ns);
+    hist_merge(&queries.b, &h->b);
+    hist_merge(&queries.n, &h->n);
+    hist_merge(&queries.s, &h->s);
+    pthread_mutex_unlock(&lock);
+}
+
+/* Upper bound of the bucket holding the q-quantile, capped at the maximum */
+static unsigned long long hist_quantile(const hist_t *h, double q) {
+    if (h->count == 0) return 0;
+    unsigned long long rank = (unsigned long long)(q * (double)(h->count - 1)) + 1;
+    unsigned long long seen = 0;
+    for (int k = 0; k < HIST_BUCKETS; k++) {
+        seen += h->bucket[k];
+        if (seen < rank) continue;
+        if (k == 0) return 0;
+        unsigned long long hi = k >= 64 ? ~0ULL : (1ULL << k) - 1;
+        return hi < h->max ? hi : h->max;
+    }
+    return h->max;
+}
+
+static void hist_write_json(FILE *out, const char *name, const hist_t *h) {
+    fprintf(out, "    \"%s\": {\"mean\": %.3f, \"max\": %llu, \"p50\": %llu, \"p90\": %llu, "
+                 "\"p99\": %llu, \"p999\": %llu, \"buckets\": [",
+            name, h->count ? h->sum / (double)h->count : 0.0, h->max,
+            hist_quantile(h, 0.50), hist_quantile(h, 0.90),
+            hist_quantile(h, 0.99), hist_quantile(h, 0.999));
+    int last = HIST_BUCKETS - 1;
+    while (last > 0 && h->bucket[last] == 0) last--;
+    for (int k = 0; k <= last; k++) {
+        fprintf(out, "%s%llu", k ? ", " : "", h->bucket[k]);
+    }
+    fprintf(out, "]}");
+}
+
+void metrics_write_json(FILE *out) {
+    if (!enabled) return;
+    phase_mark_t now = phase_begin();
+    pthread_mutex_lock(&lock);
+    fprintf(out, "{\n  \"phases\": {\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        double wall = wall_total[p], cpu = cpu_total[p];
+        if (p == PHASE_QUERY) {
+            wall -= wall_total[PHASE_WRITE];
+            cpu  -= cpu_total[PHASE_WRITE];
+        }
+        fprintf(out, "    \"%s\": {\"wall_s\": %.6f, \"cpu_s\": %.6f}%s\n",
+                PHASE_NAMES[p], wall, cpu, p + 1 < PHASE_COUNT ? "," : "");
+    }
+    fprintf(out, "  },\n  \"total\": {\"wall_s\": %.6f, \"cpu_s\": %.6f},\n",
+            now.wall - started.wall, now.cpu - started.cpu);
+    fprintf(out, "  \"queries\": {\n    \"count\": %llu,\n", queries.latency_ns.count);
+    hist_write_json(out, "latency_ns", &queries.latency_ns);
+    fprintf(out, ",\n");
+    hist_write_json(out, "b", &queries.b);
+    fprintf(out, ",\n");
+    hist_write_json(out, "n", &queries.n);
+    fprintf(out, ",\n");
+    hist_write_json(out, "s", &queries.s);
+    fprintf(out, "\n  }\n}\n");
+    pthread_mutex_unlock(&lock);
+}
@@ -1,32 +1,46 @@
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "patricia.h"
 #include "bit.h"
-#include "utils.h"   /* editDistance(...) */
+#include "utils.h"
+#include "editdist.h" /* ed_pattern_t, ed_distance_bounded(...) */
 #include "search.h"  /* search_stats_t, push_result(...) */
 #include "row.h"     /* row_t */
 
 /* ---------- Internal node & tree types ---------- */
 
-typedef struct pnode {
-    unsigned int bitIndex;      /* branching bit position (bit offset from start) */
-    struct pnode *left;         /* bit = 0 */
-    struct pnode *right;        /* bit = 1 */
-
-    int           is_leaf;      /* 1 if leaf node */
-    char         *key;          /* exact key string */
-    row_t       **rows;         /* rows for this key */
+/* Nodes live in two pools owned by the tree. Internal nodes are packed
+   pat_inner_t records (bit index + two tagged 32-bit child indices);
+   leaves carry the key and its rows and are only reached through a
+   PAT_LEAF_TAG reference, so the descent never touches leaf-only data. */
+typedef struct pleaf {
+    char         *key;          /* exact key string, NULL once freed */
+    row_id_t     *rows;         /* ids of the rows for this key */
     unsigned      count;        /* number of rows */
-    unsigned      cap;          /* capacity of rows array */
-} pnode_t;
+    unsigned      cap;          /* capacity of rows array; next free leaf once freed */
+} pleaf_t;
 
 struct patricia_tree {
-    pnode_t *root;
+    pat_inner_t      *inner;      /* internal node pool */
+    uint32_t          inner_count, inner_cap;
+    pleaf_t          *leaves;     /* leaf pool */
+    uint32_t          leaf_count, leaf_cap;
+    uint32_t          root;       /* tagged reference, PAT_NIL if empty */
+    uint32_t          free_inner; /* removed nodes, chained through child[0] */
+    uint32_t          free_leaf;  /* removed leaves, chained through cap */
+
+    int               is_image;   /* 1 if backed by a flat image */
+    patricia_image_t  img;        /* flat leaves (borrowed, read-only) */
+    const row_t      *rows;       /* rows behind img's row ids (for keys) */
 };
 
+#define IS_LEAF(ref)    (((ref) & PAT_LEAF_TAG) != 0U)
+#define LEAF_INDEX(ref) ((ref) & ~PAT_LEAF_TAG)
+
 /* ---------- Utilities & leaf-record helpers ---------- */
 
 static char *pt_strdup(const char *s) {
@@ -37,242 +51,1450 @@ static char *pt_strdup(const char *s) {
     return p;
 }
 
-static void leaf_records_init(pnode_t *n) {
+static void leaf_records_init(pleaf_t *n) {
     n->rows  = NULL;
     n->count = 0U;
     n->cap   = 0U;
 }
 
-static void leaf_records_append(pnode_t *n, row_t *rec) {
+static void leaf_records_append(pleaf_t *n, row_id_t rec) {
     if (!n->rows) {
         n->cap = 4U;
-        n->rows = (row_t**)malloc(n->cap * sizeof *n->rows);
+        n->rows = (row_id_t*)malloc(n->cap * sizeof *n->rows);
         assert(n->rows);
     } else if (n->count == n->cap) {
         n->cap *= 2U;
-        row_t **tmp = (row_t**)realloc(n->rows, n->cap * sizeof *n->rows);
+        row_id_t *tmp = (row_id_t*)realloc(n->rows, n->cap * sizeof *n->rows);
         assert(tmp);
         n->rows = tmp;
     }
     n->rows[n->count++] = rec;
 }
 
-static void leaf_records_free(pnode_t *n) {
+static void leaf_records_free(pleaf_t *n) {
     if (!n) return;
     free(n->rows);
     n->rows  = NULL;
     n->count = n->cap = 0U;
 }
 
+/* Key of a leaf (for images: the EZI_ADD of the leaf's first row). */
+static const char *leaf_key(const patricia_tree_t *t, uint32_t leaf) {
+    if (t->is_image) {
+        return t->rows[t->img.leaf_rows[t->img.leaves[leaf].first]].EZI_ADD;
+    }
+    return t->leaves[leaf].key;
+}
+
 /* Push all records from a leaf into search results (matches working code). */
-static void results_push_leaf(search_stats_t *st, const pnode_t *leaf) {
-    if (!leaf || !leaf->rows) return;
-    for (unsigned int i = 0; i < leaf->count; ++i) {
-        push_result(st, leaf->rows[i]);
+static void results_push_leaf(search_stats_t *st, const patricia_tree_t *t,
+                              uint32_t leaf) {
+    if (t->is_image) {
+        const pat_leaf_t *l = &t->img.leaves[leaf];
+        for (uint32_t i = 0; i < l->count; ++i) {
+            push_result(st, t->img.leaf_rows[l->first + i]);
+        }
+        return;
+    }
+    const pleaf_t *l = &t->leaves[leaf];
+    for (unsigned int i = 0; i < l->count; ++i) {
+        push_result(st, l->rows[i]);
     }
 }
 
 /* First differing BIT position between a & b, scanning through the '\0'.
    If equal strings, returns the bit position at the end (byte*8 of '\0'). */
 static unsigned int first_diff_bit_pos(const char *a, const char *b) {
-    unsigned int byte = 0U;
-    for (;; ++byte) {
-        unsigned char A = (unsigned char)a[byte];
-        unsigned char B = (unsigned char)b[byte];
-        if (A != B) {
-            for (int bit = 7; bit >= 0; --bit) {
-                int ba = (A >> bit) & 1, bb = (B >> bit) & 1;
-                if (ba != bb) return byte * 8U + (unsigned)(7 - bit);
-            }
-        }
-        if (A == '\0' && B == '\0') return byte * 8U; /* equal strings */
-    }
+    size_t byte = first_diff_byte(a, b);
+    unsigned char A = (unsigned char)a[byte];
+    unsigned char B = (unsigned char)b[byte];
+    if (A == B) return (unsigned int)(byte * 8U); /* equal strings */
+    return (unsigned int)(byte * 8U + byte_diff_bit(A, B));
 }
 
 /* ---------- Node creation / free ---------- */
 
-static pnode_t *new_leaf(const char *key, row_t *row) {
-    pnode_t *leaf = (pnode_t*)malloc(sizeof *leaf);
-    assert(leaf);
+/* Grow a pool so that one more element of size sz fits. */
+static void pool_reserve(void **arr, uint32_t *cap, uint32_t count, size_t sz) {
+    if (count < *cap) return;
+    assert(*cap < PAT_LEAF_TAG / 2U);   /* indices must stay below the tag */
+    uint32_t ncap = *cap ? *cap * 2U : 64U;
+    void *tmp = realloc(*arr, (size_t)ncap * sz);
+    assert(tmp);
+    *arr = tmp;
+    *cap = ncap;
+}
+
+/* Returns the tagged reference of a new leaf. */
+static uint32_t new_leaf(patricia_tree_t *t, const char *key, row_id_t row) {
+    uint32_t i = t->free_leaf;
+    if (i != PAT_NIL) {
+        t->free_leaf = t->leaves[i].cap;
+    } else {
+        pool_reserve((void**)&t->leaves, &t->leaf_cap, t->leaf_count, sizeof *t->leaves);
+        i = t->leaf_count++;
+    }
+    pleaf_t *leaf = &t->leaves[i];
     leaf->key = pt_strdup(key);
-    leaf->bitIndex = 0U;
-    leaf->is_leaf = 1;
-    leaf->left = leaf->right = NULL;
     leaf_records_init(leaf);
     leaf_records_append(leaf, row);
-    return leaf;
+    return i | PAT_LEAF_TAG;
 }
 
-static pnode_t *new_internal(unsigned int bitIndex) {
-    pnode_t *n = (pnode_t*)malloc(sizeof *n);
-    assert(n);
-    n->key = NULL;
-    n->bitIndex = bitIndex;
-    n->is_leaf = 0;
-    n->left = n->right = NULL;
-    leaf_records_init(n); /* internal nodes carry no leaf records */
-    return n;
-}
-
-static void free_node(pnode_t *n) {
-    if (!n) return;
-    free_node(n->left);
-    free_node(n->right);
-    free(n->key);
-    leaf_records_free(n);
-    free(n);
+/* Returns the index of a new internal node (children unset). */
+static uint32_t new_internal(patricia_tree_t *t, unsigned int bitIndex) {
+    uint32_t i = t->free_inner;
+    if (i != PAT_NIL) {
+        t->free_inner = t->inner[i].child[0];
+    } else {
+        pool_reserve((void**)&t->inner, &t->inner_cap, t->inner_count, sizeof *t->inner);
+        i = t->inner_count++;
+    }
+    t->inner[i].bitIndex = bitIndex;
+    t->inner[i].child[0] = t->inner[i].child[1] = PAT_NIL;
+    return i;
 }
 
 /* ---------- Public API ---------- */
 
 patricia_tree_t *create_patricia_tree(void) {
-    patricia_tree_t *t = (patricia_tree_t*)malloc(sizeof *t);
+    patricia_tree_t *t = (patricia_tree_t*)calloc(1, sizeof *t);
     assert(t);
-    t->root = NULL;
+    t->root = PAT_NIL;
+    t->free_inner = t->free_leaf = PAT_NIL;
     return t;
 }
 
 void free_patricia_tree(patricia_tree_t *t) {
     if (!t) return;
-    free_node(t->root);
+    if (!t->is_image) {                /* image memory is borrowed */
+        for (uint32_t i = 0; i < t->leaf_count; ++i) {
+            free(t->leaves[i].key);
+            leaf_records_free(&t->leaves[i]);
+        }
+        free(t->leaves);
+        free(t->inner);
+    }
     free(t);
 }
 
 /* Insert: descend to landing leaf; if identical key, append record.
    Otherwise split at first differing BIT (including through '\0'). */
-void insert_into_patricia(patricia_tree_t *t, const char *key, row_t *row) {
-    assert(t && key && row);
+void insert_into_patricia(patricia_tree_t *t, const char *key, row_id_t row) {
+    assert(t && key);
+    assert(!t->is_image);
 
-    if (!t->root) {
-        t->root = new_leaf(key, row);
+    if (t->root == PAT_NIL) {
+        t->root = new_leaf(t, key, row);
         return;
     }
 
     /* Descend to landing leaf using stored split bits. */
-    pnode_t *node = t->root;
-    while (!node->is_leaf) {
-        int bit = getBit((char*)key, node->bitIndex);
-        node = (bit == 0 ? node->left : node->right);
+    size_t klen = strlen(key);
+    uint32_t ref = t->root;
+    while (!IS_LEAF(ref)) {
+        int bit = bit_at_len(key, klen, t->inner[ref].bitIndex);
+        ref = t->inner[ref].child[bit];
     }
+    uint32_t landing = LEAF_INDEX(ref);
 
     /* First differing bit between key and landing leaf key (through '\0'). */
-    const char *k1 = key;
-    const char *k2 = node->key;
-    unsigned int lim1  = (unsigned int)((strlen(k1) + 1U) * BITS_PER_BYTE);
-    unsigned int lim2  = (unsigned int)((strlen(k2) + 1U) * BITS_PER_BYTE);
-    unsigned int limit = (lim1 < lim2 ? lim1 : lim2);
-
-    unsigned int split = 0U;
-    while (split < limit && getBit((char*)k1, split) == getBit((char*)k2, split)) {
-        ++split;
-    }
+    const char *k2 = t->leaves[landing].key;
+    size_t byte = first_diff_byte(key, k2);
 
     /* Duplicate key: append to that leaf. */
-    if (split == limit && strcmp(k1, k2) == 0) {
-        leaf_records_append(node, row);
+    if (key[byte] == k2[byte]) {
+        leaf_records_append(&t->leaves[landing], row);
         return;
     }
 
+    unsigned int split = (unsigned int)(byte * BITS_PER_BYTE)
+                       + byte_diff_bit((unsigned char)key[byte], (unsigned char)k2[byte]);
+
     /* New leaf for the incoming key. */
-    pnode_t *newLeaf = new_leaf(key, row);
+    uint32_t newLeaf = new_leaf(t, key, row);
 
     /* Find insertion point: deepest node with bitIndex < split. */
-    pnode_t *parent = NULL;
-    pnode_t *where  = t->root;
-    while (!where->is_leaf && where->bitIndex < split) {
+    uint32_t parent = PAT_NIL;
+    int      side   = 0;
+    uint32_t where  = t->root;
+    while (!IS_LEAF(where) && t->inner[where].bitIndex < split) {
         parent = where;
-        int bit = getBit((char*)key, where->bitIndex);
-        where = (bit == 0 ? where->left : where->right);
+        side   = bit_at_len(key, klen, t->inner[where].bitIndex);
+        where  = t->inner[where].child[side];
     }
 
     /* Create split node at 'split' and attach by that bit of the new key. */
-    pnode_t *branch = new_internal(split);
-    if (getBit((char*)key, split) == 0) {
-        branch->left  = newLeaf;
-        branch->right = where;
-    } else {
-        branch->left  = where;
-        branch->right = newLeaf;
-    }
+    uint32_t branch = new_internal(t, split);
+    int bit = bit_at_len(key, klen, split);
+    t->inner[branch].child[bit]  = newLeaf;
+    t->inner[branch].child[!bit] = where;
 
     /* Hook new internal node into the tree. */
-    if (!parent) {
-        t->root = branch;
+    if (parent == PAT_NIL) t->root = branch;
+    else                   t->inner[parent].child[side] = branch;
+}
+
+/* ---------- Bulk load ---------- */
+
+typedef struct key_row {
+    const char *key;
+    row_id_t    row;
+} key_row_t;
+
+static void swap_pairs(key_row_t *a, key_row_t *b) {
+    key_row_t tmp = *a; *a = *b; *b = tmp;
+}
+
+static int row_cmp(const void *a, const void *b) {
+    row_id_t x = ((const key_row_t *)a)->row, y = ((const key_row_t *)b)->row;
+    return (x > y) - (x < y);
+}
+
+/* Byte depth of p's key; '\0' past the end */
+static unsigned char byte_at(const key_row_t *p, size_t depth) {
+    return (unsigned char)p->key[depth];
+}
+
+/* Multikey quicksort (three-way radix quicksort) of p[0..n) on the key
+   bytes from depth on: shared prefixes are not compared again, unlike a
+   strcmp-based sort. Runs of equal keys end up sorted by row id. */
+static void sort_pairs(key_row_t *p, size_t n, size_t depth) {
+    while (n > 1) {
+        if (n < 16) {                   /* insertion sort on the rest of the key */
+            for (size_t i = 1; i < n; ++i) {
+                for (size_t j = i; j > 0; --j) {
+                    int c = strcmp(p[j - 1].key + depth, p[j].key + depth);
+                    if (c < 0 || (c == 0 && p[j - 1].row < p[j].row)) break;
+                    swap_pairs(&p[j - 1], &p[j]);
+                }
+            }
+            return;
+        }
+        swap_pairs(&p[0], &p[n / 2]);
+        unsigned char v = byte_at(&p[0], depth);
+        /* p[0..lt) < v, p[lt..i) == v, p[gt..n) > v */
+        size_t lt = 0, i = 1, gt = n;
+        while (i < gt) {
+            unsigned char c = byte_at(&p[i], depth);
+            if (c < v)      swap_pairs(&p[lt++], &p[i++]);
+            else if (c > v) swap_pairs(&p[i], &p[--gt]);
+            else            i++;
+        }
+        sort_pairs(p, lt, depth);
+        sort_pairs(p + gt, n - gt, depth);
+        if (v == '\0') {                /* identical keys: order by row id */
+            qsort(p + lt, gt - lt, sizeof *p, row_cmp);
+            return;
+        }
+        p += lt;                        /* loop on the equal part, one byte deeper */
+        n = gt - lt;
+        depth++;
+    }
+}
+
+/* Number of distinct keys in sorted p[0..n) */
+static uint32_t count_distinct(const key_row_t *p, size_t n) {
+    uint32_t m = 0U;
+    for (size_t i = 0; i < n; ++i)
+        if (i == 0 || strcmp(p[i - 1].key, p[i].key) != 0) m++;
+    return m;
+}
+
+/* One leaf per distinct key of sorted p[0..n), written from leaves[0] on */
+static void fill_leaves(pleaf_t *leaves, const key_row_t *p, size_t n) {
+    for (size_t i = 0, l = 0; i < n; ++l) {
+        size_t j = i + 1;
+        while (j < n && strcmp(p[j].key, p[i].key) == 0) j++;
+        pleaf_t *leaf = &leaves[l];
+        leaf->key = pt_strdup(p[i].key);
+        leaf->count = leaf->cap = (unsigned)(j - i);
+        leaf->rows = malloc(leaf->cap * sizeof *leaf->rows);
+        assert(leaf->rows);
+        for (size_t k = i; k < j; ++k) leaf->rows[k - i] = p[k].row;
+        i = j;
+    }
+}
+
+/* Join subtrees item[0..gaps] (tagged references, in key order), where
+   gap g between item[g] and item[g + 1] branches at bit[g]. The result is
+   the min-Cartesian tree of the gaps: a range's smallest bit is unique and
+   becomes its branch node. It is built with a stack in one pass, and its
+   gaps branch nodes are written to inner[base..] in DFS preorder. Returns
+   the root reference. */
+static uint32_t join_subtrees(pat_inner_t *inner, uint32_t base, const uint32_t *bit,
+                              const uint32_t *item, uint32_t gaps) {
+    if (gaps == 0U) return item[0];
+    /* Children are gap indices, or item indices with PAT_LEAF_TAG */
+    uint32_t *left  = malloc(gaps * sizeof *left);
+    uint32_t *right = malloc(gaps * sizeof *right);
+    uint32_t *stack = malloc(gaps * sizeof *stack);
+    uint32_t *slot  = malloc(gaps * sizeof *slot);
+    assert(left && right && stack && slot);
+    uint32_t top = 0U;
+    for (uint32_t g = 0; g < gaps; ++g) {
+        uint32_t last = PAT_NIL;
+        while (top > 0U && bit[stack[top - 1U]] > bit[g]) last = stack[--top];
+        left[g]  = last != PAT_NIL ? last : (g | PAT_LEAF_TAG);
+        right[g] = (g + 1U) | PAT_LEAF_TAG;
+        if (top > 0U) right[stack[top - 1U]] = g;
+        stack[top++] = g;
+    }
+    uint32_t root = stack[0];
+
+    /* Number the branch nodes in preorder (left subtree first), then fill */
+    uint32_t next = base;
+    top = 0U;
+    stack[top++] = root;
+    while (top > 0U) {
+        uint32_t g = stack[--top];
+        slot[g] = next++;
+        if (!IS_LEAF(right[g])) stack[top++] = right[g];
+        if (!IS_LEAF(left[g]))  stack[top++] = left[g];
+    }
+    for (uint32_t g = 0; g < gaps; ++g) {
+        pat_inner_t *node = &inner[slot[g]];
+        node->bitIndex = bit[g];
+        node->child[0] = IS_LEAF(left[g])  ? item[LEAF_INDEX(left[g])]  : slot[left[g]];
+        node->child[1] = IS_LEAF(right[g]) ? item[LEAF_INDEX(right[g])] : slot[right[g]];
+    }
+    root = slot[root];
+    free(left); free(right); free(stack); free(slot);
+    return root;
+}
+
+/* Subtree over leaves [first, first + m), branch nodes at inner[base..] */
+static uint32_t build_range(patricia_tree_t *t, uint32_t first, uint32_t m,
+                            uint32_t base) {
+    uint32_t *bit  = malloc((m ? m : 1U) * sizeof *bit);
+    uint32_t *item = malloc((m ? m : 1U) * sizeof *item);
+    assert(bit && item);
+    for (uint32_t i = 0; i < m; ++i) {
+        item[i] = (first + i) | PAT_LEAF_TAG;
+        if (i + 1U < m)
+            bit[i] = first_diff_bit_pos(t->leaves[first + i].key,
+                                        t->leaves[first + i + 1U].key);
+    }
+    uint32_t root = join_subtrees(t->inner, base, bit, item, m - 1U);
+    free(bit);
+    free(item);
+    return root;
+}
+
+/* Allocate the pools of a bulk-loaded tree: m leaves, m - 1 branch nodes */
+static void reserve_pools(patricia_tree_t *t, uint32_t m) {
+    assert(m < PAT_LEAF_TAG);
+    t->leaves = malloc((m ? m : 1U) * sizeof *t->leaves);
+    t->inner  = malloc((m > 1U ? m - 1U : 1U) * sizeof *t->inner);
+    assert(t->leaves && t->inner);
+    t->leaf_count = t->leaf_cap = m;
+    t->inner_count = t->inner_cap = m ? m - 1U : 0U;
+}
+
+/* (key, row) pairs of the non-NULL keys, in row order; *n receives their count */
+static key_row_t *gather_pairs(const char *const keys[], size_t count, size_t *n) {
+    key_row_t *pairs = malloc((count ? count : 1U) * sizeof *pairs);
+    assert(pairs);
+    *n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!keys[i]) continue;
+        pairs[*n].key = keys[i];
+        pairs[*n].row = (row_id_t)i;
+        (*n)++;
+    }
+    return pairs;
+}
+
+patricia_tree_t *patricia_bulk_load(const char *const keys[], size_t count) {
+    patricia_tree_t *t = create_patricia_tree();
+    size_t n;
+    key_row_t *pairs = gather_pairs(keys, count, &n);
+    if (n == 0) { free(pairs); return t; }
+    sort_pairs(pairs, n, 0);
+
+    uint32_t m = count_distinct(pairs, n);
+    reserve_pools(t, m);
+    fill_leaves(t->leaves, pairs, n);
+    free(pairs);
+    t->root = build_range(t, 0U, m, 0U);
+    return t;
+}
+
+/* ---------- Parallel bulk load ---------- */
+
+/* Pairs are partitioned on the first two key bytes (the top 16 bits), so
+   every key of a bucket sorts before every key of the next one and the
+   bits separating buckets are all below 16, while those inside a bucket
+   are not. Each bucket is therefore a complete subtree of the final tree,
+   built on its own from its own slice of the pools, and the bucket roots
+   are then joined by the buckets' boundary bits. */
+#define BULK_BUCKETS 65536U
+#define BULK_CLAIM   64U                /* buckets claimed per lock */
+
+typedef struct bulk_job {
+    patricia_tree_t *t;
+    key_row_t       *pairs;             /* bucket b: [start[b], start[b + 1]) */
+    const size_t    *start;
+    uint32_t        *distinct;          /* distinct keys per bucket */
+    const uint32_t  *leaf_base;         /* first leaf of each bucket */
+    const uint32_t  *inner_base;        /* first branch node of each bucket */
+    uint32_t        *root;              /* subtree root of each bucket */
+    int              phase;             /* 1 = sort and count, 2 = build */
+    uint32_t         next;              /* next unclaimed bucket */
+    pthread_mutex_t  lock;
+} bulk_job_t;
+
+static unsigned bucket_of(const char *key) {
+    unsigned char a = (unsigned char)key[0];
+    return a ? (unsigned)a << 8 | (unsigned char)key[1] : 0U;
+}
+
+static void *bulk_worker(void *arg) {
+    bulk_job_t *job = arg;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        uint32_t first = job->next;
+        job->next += BULK_CLAIM;
+        pthread_mutex_unlock(&job->lock);
+        if (first >= BULK_BUCKETS) return NULL;
+
+        for (uint32_t b = first; b < first + BULK_CLAIM; ++b) {
+            size_t n = job->start[b + 1U] - job->start[b];
+            if (n == 0) continue;
+            key_row_t *p = job->pairs + job->start[b];
+            if (job->phase == 1) {
+                /* the bucket fixes bytes 0 and 1 unless the key ends first */
+                size_t depth = b == 0U ? 0U : (b & 0xFFU) == 0U ? 1U : 2U;
+                sort_pairs(p, n, depth);
+                job->distinct[b] = count_distinct(p, n);
+            } else {
+                fill_leaves(&job->t->leaves[job->leaf_base[b]], p, n);
+                job->root[b] = build_range(job->t, job->leaf_base[b],
+                                           job->distinct[b], job->inner_base[b]);
+            }
+        }
+    }
+}
+
+static void run_bulk_phase(bulk_job_t *job, int phase, int nthreads) {
+    pthread_t tids[64];
+    if (nthreads > 64) nthreads = 64;
+    job->phase = phase;
+    job->next = 0U;
+    int started = 0;
+    for (; started < nthreads; ++started)
+        if (pthread_create(&tids[started], NULL, bulk_worker, job) != 0) break;
+    if (started == 0) bulk_worker(job);
+    for (int i = 0; i < started; ++i) pthread_join(tids[i], NULL);
+}
+
+patricia_tree_t *patricia_bulk_load_parallel(const char *const keys[], size_t count,
+                                             int nthreads) {
+    if (nthreads <= 1) return patricia_bulk_load(keys, count);
+    patricia_tree_t *t = create_patricia_tree();
+    size_t n;
+    key_row_t *in = gather_pairs(keys, count, &n);
+    if (n == 0) { free(in); return t; }
+
+    /* Counting sort into buckets (stable, so rows stay in order) */
+    size_t   *start      = calloc(BULK_BUCKETS + 1U, sizeof *start);
+    uint32_t *distinct   = calloc(BULK_BUCKETS, sizeof *distinct);
+    uint32_t *leaf_base  = malloc(BULK_BUCKETS * sizeof *leaf_base);
+    uint32_t *inner_base = malloc(BULK_BUCKETS * sizeof *inner_base);
+    uint32_t *root       = malloc(BULK_BUCKETS * sizeof *root);
+    key_row_t *pairs     = malloc(n * sizeof *pairs);
+    assert(start && distinct && leaf_base && inner_base && root && pairs);
+    for (size_t i = 0; i < n; ++i) start[bucket_of(in[i].key) + 1U]++;
+    for (uint32_t b = 0; b < BULK_BUCKETS; ++b) start[b + 1U] += start[b];
+    {
+        size_t *fill = malloc(BULK_BUCKETS * sizeof *fill);
+        assert(fill);
+        memcpy(fill, start, BULK_BUCKETS * sizeof *fill);
+        for (size_t i = 0; i < n; ++i) pairs[fill[bucket_of(in[i].key)]++] = in[i];
+        free(fill);
+    }
+    free(in);
+
+    bulk_job_t job;
+    memset(&job, 0, sizeof job);
+    job.t = t;
+    job.pairs = pairs;
+    job.start = start;
+    job.distinct = distinct;
+    job.leaf_base = leaf_base;
+    job.inner_base = inner_base;
+    job.root = root;
+    pthread_mutex_init(&job.lock, NULL);
+    run_bulk_phase(&job, 1, nthreads);
+
+    /* Slices: the joining nodes first, then each bucket's m - 1 nodes */
+    uint32_t m = 0U, used = 0U;
+    for (uint32_t b = 0; b < BULK_BUCKETS; ++b) {
+        leaf_base[b] = m;
+        m += distinct[b];
+        if (distinct[b]) used++;
+    }
+    uint32_t next_inner = used - 1U;
+    for (uint32_t b = 0; b < BULK_BUCKETS; ++b) {
+        inner_base[b] = next_inner;
+        if (distinct[b]) next_inner += distinct[b] - 1U;
+    }
+    reserve_pools(t, m);
+    run_bulk_phase(&job, 2, nthreads);
+    pthread_mutex_destroy(&job.lock);
+
+    /* Join the bucket subtrees at their boundary bits */
+    uint32_t *bit  = malloc(used * sizeof *bit);
+    uint32_t *item = malloc(used * sizeof *item);
+    assert(bit && item);
+    uint32_t k = 0U;
+    for (uint32_t b = 0; b < BULK_BUCKETS; ++b) {
+        if (!distinct[b]) continue;
+        if (k > 0U)
+            bit[k - 1U] = first_diff_bit_pos(t->leaves[leaf_base[b] - 1U].key,
+                                             t->leaves[leaf_base[b]].key);
+        item[k++] = root[b];
+    }
+    t->root = join_subtrees(t->inner, 0U, bit, item, used - 1U);
+
+    free(bit); free(item);
+    free(pairs); free(start); free(distinct);
+    free(leaf_base); free(inner_base); free(root);
+    return t;
+}
+
+/* ---------- Lookup, removal & update ---------- */
+
+/* Leaf holding exactly key, or PAT_NIL. Records the parent and
+   grandparent of that leaf (PAT_NIL when absent) and the sides taken. */
+static uint32_t find_leaf(const patricia_tree_t *t, const char *key,
+                          uint32_t *parent, int *pside,
+                          uint32_t *grand, int *gside) {
+    size_t klen = strlen(key);
+    uint32_t ref = t->root;
+    *parent = *grand = PAT_NIL;
+    *pside = *gside = 0;
+    if (ref == PAT_NIL) return PAT_NIL;
+    while (!IS_LEAF(ref)) {
+        int bit = bit_at_len(key, klen, t->inner[ref].bitIndex);
+        *grand = *parent; *gside = *pside;
+        *parent = ref;    *pside = bit;
+        ref = t->inner[ref].child[bit];
+    }
+    uint32_t leaf = LEAF_INDEX(ref);
+    return strcmp(leaf_key(t, leaf), key) == 0 ? leaf : PAT_NIL;
+}
+
+const row_id_t *patricia_lookup(const patricia_tree_t *t, const char *key,
+                                unsigned *count) {
+    uint32_t parent, grand;
+    int pside, gside;
+    uint32_t leaf = t ? find_leaf(t, key, &parent, &pside, &grand, &gside) : PAT_NIL;
+    if (leaf == PAT_NIL) { *count = 0U; return NULL; }
+    if (t->is_image) {
+        *count = t->img.leaves[leaf].count;
+        return &t->img.leaf_rows[t->img.leaves[leaf].first];
+    }
+    *count = t->leaves[leaf].count;
+    return t->leaves[leaf].rows;
+}
+
+/* Unlink a leaf: its parent is replaced by the sibling subtree, and both
+   the leaf and the parent go onto the free lists. */
+static void unlink_leaf(patricia_tree_t *t, uint32_t leaf, uint32_t parent,
+                        int pside, uint32_t grand, int gside) {
+    if (parent == PAT_NIL) {
+        t->root = PAT_NIL;
     } else {
-        if (getBit((char*)key, parent->bitIndex) == 0) parent->left = branch;
-        else                                           parent->right = branch;
+        uint32_t sibling = t->inner[parent].child[!pside];
+        if (grand == PAT_NIL) t->root = sibling;
+        else                  t->inner[grand].child[gside] = sibling;
+        t->inner[parent].child[0] = t->free_inner;
+        t->inner[parent].child[1] = PAT_NIL;
+        t->free_inner = parent;
+    }
+    pleaf_t *l = &t->leaves[leaf];
+    free(l->key);
+    l->key = NULL;
+    leaf_records_free(l);
+    l->cap = t->free_leaf;
+    t->free_leaf = leaf;
+}
+
+unsigned patricia_remove_key(patricia_tree_t *t, const char *key) {
+    assert(t && key);
+    assert(!t->is_image);
+    uint32_t parent, grand;
+    int pside, gside;
+    uint32_t leaf = find_leaf(t, key, &parent, &pside, &grand, &gside);
+    if (leaf == PAT_NIL) return 0U;
+    unsigned removed = t->leaves[leaf].count;
+    unlink_leaf(t, leaf, parent, pside, grand, gside);
+    return removed;
+}
+
+int patricia_remove_row(patricia_tree_t *t, const char *key, row_id_t row) {
+    assert(t && key);
+    assert(!t->is_image);
+    uint32_t parent, grand;
+    int pside, gside;
+    uint32_t leaf = find_leaf(t, key, &parent, &pside, &grand, &gside);
+    if (leaf == PAT_NIL) return 0;
+    pleaf_t *l = &t->leaves[leaf];
+    unsigned i = 0U;
+    while (i < l->count && l->rows[i] != row) i++;
+    if (i == l->count) return 0;
+    if (l->count == 1U) {
+        unlink_leaf(t, leaf, parent, pside, grand, gside);
+        return 1;
+    }
+    /* Keep the remaining rows in insertion order */
+    memmove(&l->rows[i], &l->rows[i + 1U], (l->count - i - 1U) * sizeof *l->rows);
+    l->count--;
+    return 1;
+}
+
+int patricia_replace_row(patricia_tree_t *t, const char *key,
+                         row_id_t old_row, row_id_t new_row) {
+    assert(t && key);
+    assert(!t->is_image);
+    uint32_t parent, grand;
+    int pside, gside;
+    uint32_t leaf = find_leaf(t, key, &parent, &pside, &grand, &gside);
+    if (leaf == PAT_NIL) return 0;
+    pleaf_t *l = &t->leaves[leaf];
+    for (unsigned i = 0; i < l->count; ++i) {
+        if (l->rows[i] == old_row) {
+            l->rows[i] = new_row;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ---------- Flat image ---------- */
+
+int patricia_export_image(const patricia_tree_t *t, patricia_image_t *img) {
+    assert(t && img);
+    memset(img, 0, sizeof *img);
+    img->root = PAT_NIL;
+    if (t->is_image) return -1;          /* already flat */
+    if (t->root == PAT_NIL) return 0;
+
+    /* Number the reachable nodes in preorder, child[0] first, so leaves
+       come out in key order and the image depends only on the tree's
+       shape, not on pool order (parallel builds, free-listed nodes). */
+    uint32_t *inner_order = malloc((t->inner_count ? t->inner_count : 1U) * sizeof *inner_order);
+    uint32_t *leaf_order  = malloc(t->leaf_count * sizeof *leaf_order);
+    uint32_t *inner_id    = malloc((t->inner_count ? t->inner_count : 1U) * sizeof *inner_id);
+    uint32_t *leaf_id     = malloc(t->leaf_count * sizeof *leaf_id);
+    uint32_t *stack       = malloc(((size_t)t->inner_count + 1U) * 2U * sizeof *stack);
+    uint32_t ninner = 0U, nleaf = 0U, total = 0U;
+    if (inner_order && leaf_order && inner_id && leaf_id && stack) {
+        size_t top = 0;
+        stack[top++] = t->root;
+        while (top > 0) {
+            uint32_t ref = stack[--top];
+            if (IS_LEAF(ref)) {
+                leaf_id[LEAF_INDEX(ref)] = nleaf;
+                leaf_order[nleaf++] = LEAF_INDEX(ref);
+                total += t->leaves[LEAF_INDEX(ref)].count;
+                continue;
+            }
+            inner_id[ref] = ninner;
+            inner_order[ninner++] = ref;
+            stack[top++] = t->inner[ref].child[1];
+            stack[top++] = t->inner[ref].child[0];
+        }
+    }
+
+    pat_inner_t *inner  = malloc((ninner ? ninner : 1U) * sizeof *inner);
+    pat_leaf_t  *leaves = malloc((nleaf ? nleaf : 1U) * sizeof *leaves);
+    uint32_t *leaf_rows = malloc((total ? total : 1U) * sizeof *leaf_rows);
+
+    img->inner = inner; img->leaves = leaves; img->leaf_rows = leaf_rows;
+    int ok = inner_order && leaf_order && inner_id && leaf_id && stack &&
+             inner && leaves && leaf_rows;
+    if (ok) {
+        for (uint32_t i = 0; i < ninner; ++i) {
+            const pat_inner_t *n = &t->inner[inner_order[i]];
+            inner[i].bitIndex = n->bitIndex;
+            for (int c = 0; c < 2; ++c) {
+                uint32_t ref = n->child[c];
+                inner[i].child[c] = IS_LEAF(ref) ? (leaf_id[LEAF_INDEX(ref)] | PAT_LEAF_TAG)
+                                                 : inner_id[ref];
+            }
+        }
+        uint32_t k = 0U;
+        for (uint32_t i = 0; i < nleaf; ++i) {
+            const pleaf_t *l = &t->leaves[leaf_order[i]];
+            leaves[i].first = k;
+            leaves[i].count = l->count;
+            for (unsigned j = 0; j < l->count; ++j) leaf_rows[k++] = l->rows[j];
+        }
+        img->inner_count    = ninner;
+        img->leaf_count     = nleaf;
+        img->leaf_row_count = total;
+        img->root = IS_LEAF(t->root) ? (leaf_id[LEAF_INDEX(t->root)] | PAT_LEAF_TAG)
+                                     : inner_id[t->root];
+    }
+    free(inner_order); free(leaf_order); free(inner_id); free(leaf_id); free(stack);
+    if (!ok) { patricia_free_image(img); return -1; }
+    return 0;
+}
+
+void patricia_free_image(patricia_image_t *img) {
+    if (!img) return;
+    free((void*)img->inner);
+    free((void*)img->leaves);
+    free((void*)img->leaf_rows);
+    memset(img, 0, sizeof *img);
+    img->root = PAT_NIL;
+}
+
+patricia_tree_t *patricia_from_image(const patricia_image_t *img, const row_t *rows) {
+    assert(img && rows);
+    patricia_tree_t *t = create_patricia_tree();
+    t->is_image    = 1;
+    t->img         = *img;
+    t->rows        = rows;
+    t->inner       = (pat_inner_t*)img->inner;   /* read-only from here on */
+    t->inner_count = img->inner_count;
+    t->leaf_count  = img->leaf_count;
+    t->root        = img->root;
+    return t;
+}
+
+patricia_tree_t *patricia_thaw(const patricia_tree_t *t) {
+    assert(t && t->is_image);
+    patricia_tree_t *c = create_patricia_tree();
+    uint32_t ic = t->img.inner_count, lc = t->img.leaf_count;
+    c->inner  = malloc((ic ? ic : 1U) * sizeof *c->inner);
+    c->leaves = malloc((lc ? lc : 1U) * sizeof *c->leaves);
+    assert(c->inner && c->leaves);
+    memcpy(c->inner, t->img.inner, ic * sizeof *c->inner);
+    c->inner_count = c->inner_cap = ic;
+    c->leaf_count = c->leaf_cap = lc;
+    for (uint32_t i = 0; i < lc; ++i) {
+        const pat_leaf_t *l = &t->img.leaves[i];
+        pleaf_t *n = &c->leaves[i];
+        if (l->count == 0U) {               /* removed before export */
+            n->key = NULL;
+            n->rows = NULL;
+            n->count = 0U;
+            n->cap = c->free_leaf;
+            c->free_leaf = i;
+            continue;
+        }
+        n->key = pt_strdup(leaf_key(t, i));
+        n->count = n->cap = l->count;
+        n->rows = malloc(l->count * sizeof *n->rows);
+        assert(n->rows);
+        memcpy(n->rows, &t->img.leaf_rows[l->first], l->count * sizeof *n->rows);
+    }
+    c->root = t->root;
+    return c;
+}
+
+/* ---------- Search ---------- */
+
+/* State of one fuzzy scan over a subtree.
+   The walk keeps one Levenshtein DP row (query along the columns) per key
+   byte consumed on the current root-to-node path. Keys under an internal
+   node share all bytes before its branching byte, so those rows are
+   computed once per subtree and shared by every key below it; a subtree
+   whose row minimum already exceeds the bound is skipped whole. Leaves
+   that survive are scored on their full key with the Myers kernels.
+   The k best leaves are kept in a max-heap ordered by (distance, key). */
+typedef struct fuzzy_cand {
+    uint32_t leaf;
+    int      d;
+} fuzzy_cand_t;
+
+typedef struct fuzzy_scan {
+    const patricia_tree_t *t;
+    const char  *q;
+    int          qlen;
+    ed_pattern_t pat;
+    int          limit;             /* reject distances above this */
+    fuzzy_cand_t *heap;             /* worst kept candidate at heap[0] */
+    unsigned     heap_size;
+    unsigned     heap_cap;          /* k */
+    fuzzy_cand_t one;               /* heap storage when k == 1 */
+    uint32_t     pending[ED_BATCH];
+    int          npending;
+    int         *rows;              /* rows[d * (qlen + 1) + j] */
+    int         *row_min;           /* minimum of each row */
+    int          rows_cap;          /* number of rows allocated */
+} fuzzy_scan_t;
+
+static void fuzzy_scan_init(fuzzy_scan_t *fs, const patricia_tree_t *t,
+                            const char *q, unsigned k, int limit) {
+    assert(k > 0U);
+    fs->t = t; fs->q = q; fs->qlen = (int)strlen(q);
+    fs->limit = limit;
+    fs->heap_size = 0U; fs->heap_cap = k; fs->npending = 0;
+    fs->heap = (k == 1U) ? &fs->one : malloc(k * sizeof *fs->heap);
+    assert(fs->heap);
+    ed_pattern_init(&fs->pat, q, fs->qlen);
+    fs->rows_cap = 64;
+    fs->rows = malloc((size_t)fs->rows_cap * (fs->qlen + 1) * sizeof *fs->rows);
+    fs->row_min = malloc((size_t)fs->rows_cap * sizeof *fs->row_min);
+    assert(fs->rows && fs->row_min);
+    for (int j = 0; j <= fs->qlen; ++j) fs->rows[j] = j;   /* empty key prefix */
+    fs->row_min[0] = 0;
+}
+
+static void fuzzy_scan_free(fuzzy_scan_t *fs) {
+    if (fs->heap != &fs->one) free(fs->heap);
+    ed_pattern_free(&fs->pat);
+    free(fs->rows);
+    free(fs->row_min);
+}
+
+/* Current pruning bound: once k candidates are kept, the worst of them,
+   capped by the limit. Equal distances must still be scored for ties. */
+static int fuzzy_bound(const fuzzy_scan_t *fs) {
+    if (fs->heap_size == fs->heap_cap && fs->heap[0].d < fs->limit) return fs->heap[0].d;
+    return fs->limit;
+}
+
+/* Candidate order: smaller distance first, then alphabetic key. */
+static int cand_cmp(const fuzzy_scan_t *fs, const fuzzy_cand_t *a, const fuzzy_cand_t *b) {
+    if (a->d != b->d) return a->d < b->d ? -1 : 1;
+    return strcmp(leaf_key(fs->t, a->leaf), leaf_key(fs->t, b->leaf));
+}
+
+/* Restore the max-heap property from slot i downwards. */
+static void heap_sift_down(fuzzy_scan_t *fs, unsigned i) {
+    for (;;) {
+        unsigned l = 2U * i + 1U, r = l + 1U, top = i;
+        if (l < fs->heap_size && cand_cmp(fs, &fs->heap[l], &fs->heap[top]) > 0) top = l;
+        if (r < fs->heap_size && cand_cmp(fs, &fs->heap[r], &fs->heap[top]) > 0) top = r;
+        if (top == i) return;
+        fuzzy_cand_t tmp = fs->heap[i]; fs->heap[i] = fs->heap[top]; fs->heap[top] = tmp;
+        i = top;
+    }
+}
+
+/* Extend the DP rows from key depth `from` to `to` with key[from..to). */
+static void extend_rows(fuzzy_scan_t *fs, const char *key, int from, int to) {
+    int w = fs->qlen + 1;
+    if (to >= fs->rows_cap) {
+        while (to >= fs->rows_cap) fs->rows_cap *= 2;
+        fs->rows = realloc(fs->rows, (size_t)fs->rows_cap * w * sizeof *fs->rows);
+        fs->row_min = realloc(fs->row_min, (size_t)fs->rows_cap * sizeof *fs->row_min);
+        assert(fs->rows && fs->row_min);
+    }
+    for (int i = from; i < to; ++i) {
+        const int *prev = fs->rows + (size_t)i * w;
+        int *cur = fs->rows + (size_t)(i + 1) * w;
+        char c = key[i];
+        cur[0] = i + 1;
+        int m = cur[0];
+        for (int j = 1; j <= fs->qlen; ++j) {
+            int v = (c == fs->q[j - 1]) ? prev[j - 1] : prev[j - 1] + 1;
+            if (prev[j] + 1 < v) v = prev[j] + 1;
+            if (cur[j - 1] + 1 < v) v = cur[j - 1] + 1;
+            cur[j] = v;
+            if (v < m) m = v;
+        }
+        fs->row_min[i + 1] = m;
     }
 }
 
-/* DFS without touching counters: pick min edit distance, then alphabetic. */
-static void dfs_best_leaf_no_count(pnode_t *node, const char *q,
-                                   pnode_t **best, int *bestd) {
-    if (!node) return;
-    if (node->is_leaf) {
-        int d = editDistance((char*)q, (char*)node->key,
-                             (int)strlen(q), (int)strlen(node->key));
-        if (!*best || d < *bestd || (d == *bestd && strcmp(node->key, (*best)->key) < 0)) {
-            *best = node; *bestd = d;
+/* Keep leaf if it is among the k best so far: min edit distance, then alphabetic. */
+static void consider_scored(fuzzy_scan_t *fs, uint32_t leaf, int d) {
+    if (d > fs->limit) return;
+    fuzzy_cand_t c = { leaf, d };
+    if (fs->heap_size < fs->heap_cap) {
+        unsigned i = fs->heap_size++;
+        while (i > 0U && cand_cmp(fs, &fs->heap[(i - 1U) / 2U], &c) < 0) {
+            fs->heap[i] = fs->heap[(i - 1U) / 2U];
+            i = (i - 1U) / 2U;
         }
+        fs->heap[i] = c;
+    } else if (cand_cmp(fs, &c, &fs->heap[0]) < 0) {
+        fs->heap[0] = c;
+        heap_sift_down(fs, 0U);
+    }
+}
+
+/* Score queued leaves in one multi-lane call. */
+static void flush_pending(fuzzy_scan_t *fs) {
+    const char *keys[ED_BATCH];
+    int lens[ED_BATCH], d[ED_BATCH];
+    for (int i = 0; i < fs->npending; ++i) {
+        keys[i] = leaf_key(fs->t, fs->pending[i]);
+        lens[i] = (int)strlen(keys[i]);
+    }
+    ed_distance_batch(&fs->pat, keys, lens, fs->npending, d);
+    for (int i = 0; i < fs->npending; ++i) consider_scored(fs, fs->pending[i], d[i]);
+    fs->npending = 0;
+}
+
+/* Consider one leaf as the fuzzy answer. Distances are only computed up to
+   the current bound, since a leaf further away can never win; single-word
+   queries are batched across leaves instead. */
+static void consider_leaf(fuzzy_scan_t *fs, uint32_t leaf) {
+    const char *key = leaf_key(fs->t, leaf);
+    int klen = (int)strlen(key);
+    int bound = fuzzy_bound(fs);
+    int gap = klen > fs->qlen ? klen - fs->qlen : fs->qlen - klen;
+    if (gap > bound) return;               /* length difference alone loses */
+    if (fs->pat.blocks == 1 && fs->heap_size > 0U) {
+        fs->pending[fs->npending++] = leaf;
+        if (fs->npending == ED_BATCH) flush_pending(fs);
         return;
     }
-    dfs_best_leaf_no_count(node->left,  q, best, bestd);
-    dfs_best_leaf_no_count(node->right, q, best, bestd);
+    int d = ed_distance_bounded(&fs->pat, key, klen, bound);
+    if (d <= bound) consider_scored(fs, leaf, d);
 }
 
-/* Search: matches the working file’s observable behaviour EXACTLY.
-   - Initialises out with capacity = 1U.
-   - Walks path counting node comparisons.
-   - Does one strcmp_bits_firstdiff (updates string & bit counters).
-   - If exact: pushes landing leaf’s rows.
-   - Else: chooses mismatch node (exact diff bit if on path, else deepest < diff, else root),
-           does DFS for "best" but (crucially) pushes the LANDING leaf’s rows if best exists. */
-void search_patricia(patricia_tree_t *t, const char *query, search_stats_t *out) {
-    /* Initialise like the working code */
-    out->results = NULL; 
-    out->result_count = 0U; 
+/* Any key stored under ref (all of them share the bytes above ref). */
+static const char *subtree_key(const patricia_tree_t *t, uint32_t ref) {
+    while (!IS_LEAF(ref)) ref = t->inner[ref].child[0];
+    return leaf_key(t, LEAF_INDEX(ref));
+}
+
+/* Trie walk without touching counters: pick min edit distance, then
+   alphabetic. Rows 0..depth are valid for every key under ref. */
+static void dfs_best_leaf_no_count(fuzzy_scan_t *fs, uint32_t ref, int depth) {
+    if (ref == PAT_NIL) return;
+    if (IS_LEAF(ref)) {
+        consider_leaf(fs, LEAF_INDEX(ref));
+        return;
+    }
+    int shared = (int)(fs->t->inner[ref].bitIndex / BITS_PER_BYTE);
+    if (shared > depth) {
+        extend_rows(fs, subtree_key(fs->t, ref), depth, shared);
+        depth = shared;
+    }
+    if (fs->row_min[depth] > fuzzy_bound(fs)) return;   /* whole subtree too far */
+    dfs_best_leaf_no_count(fs, fs->t->inner[ref].child[0], depth);
+    dfs_best_leaf_no_count(fs, fs->t->inner[ref].child[1], depth);
+}
+
+/* Descend to the landing leaf, counting nodes and the one string
+   comparison, and return the landing leaf index. Bits past the end of
+   query read as 0. */
+static uint32_t descend(const patricia_tree_t *t, const char *query,
+                        search_stats_t *out) {
+    size_t qlen = strlen(query);
+    uint32_t ref = t->root;
+    while (!IS_LEAF(ref)) {
+        out->node_comparisons++;
+        int bit = bit_at_len(query, qlen, t->inner[ref].bitIndex);
+        ref = t->inner[ref].child[bit];
+    }
+    out->node_comparisons++;               /* landing leaf */
+    uint32_t landing = LEAF_INDEX(ref);
+
+    /* One string comparison updates bit counter. */
+    out->string_comparisons++;
+    strcmp_bits_firstdiff(query, leaf_key(t, landing), &out->bit_comparisons);
+    return landing;
+}
+
+static void stats_init(search_stats_t *out) {
+    out->results = NULL;
+    out->result_count = 0U;
     out->capacity = 0U;
-    out->bit_comparisons = 0ULL; 
-    out->node_comparisons = 0U; 
+    out->bit_comparisons = 0ULL;
+    out->node_comparisons = 0U;
     out->string_comparisons = 0U;
-    if (!t || !t->root) return;
+    out->distances = NULL;
+}
+
+/* Search: matches the working file's observable behaviour EXACTLY.
+   - Walks the path counting node comparisons.
+   - Does one strcmp_bits_firstdiff (updates string & bit counters).
+   - Pushes the landing leaf's rows, on a hit and on a miss alike.
+   The working code ran an edit-distance scan under the mismatch node on a
+   miss, but then pushed the landing leaf whenever the scan found anything,
+   which it always does (the subtree holds at least the landing leaf). The
+   scan is skipped: it was uncounted and could not change the output.
+   search_patricia_topk is the real closest-match search. */
+void search_patricia(patricia_tree_t *t, const char *query, search_stats_t *out) {
+    stats_init(out);
+    if (!t || t->root == PAT_NIL) return;
+    results_push_leaf(out, t, descend(t, query, out));
+}
+
+/* Queries advanced together by search_patricia_batch */
+#define BATCH_GROUP 16
+
+/* Per-query state of an interleaved descent */
+typedef struct batch_lane {
+    const char *query;
+    size_t      qlen;
+    uint32_t    ref;            /* current node */
+} batch_lane_t;
+
+void search_patricia_batch(patricia_tree_t *t, const char *const queries[],
+                           size_t n, search_stats_t stats[]) {
+    for (size_t i = 0; i < n; ++i) stats_init(&stats[i]);
+    if (!t || t->root == PAT_NIL) return;
+
+    batch_lane_t lanes[BATCH_GROUP];
+    for (size_t base = 0; base < n; base += BATCH_GROUP) {
+        unsigned g = (unsigned)(n - base < BATCH_GROUP ? n - base : BATCH_GROUP);
+        for (unsigned k = 0; k < g; ++k) {
+            lanes[k].query = queries[base + k];
+            lanes[k].qlen  = strlen(lanes[k].query);
+            lanes[k].ref   = t->root;
+        }
+
+        /* Round-robin: move every unfinished lane down one level, and
+           prefetch the child it lands on while the other lanes run. */
+        unsigned active = g;
+        while (active > 0U) {
+            active = 0U;
+            for (unsigned k = 0; k < g; ++k) {
+                batch_lane_t *l = &lanes[k];
+                if (IS_LEAF(l->ref)) continue;
+                const pat_inner_t *node = &t->inner[l->ref];
+                stats[base + k].node_comparisons++;
+                l->ref = node->child[bit_at_len(l->query, l->qlen, node->bitIndex)];
+                if (!IS_LEAF(l->ref)) {
+                    __builtin_prefetch(&t->inner[l->ref]);
+                    active++;
+                } else if (!t->is_image) {
+                    __builtin_prefetch(&t->leaves[LEAF_INDEX(l->ref)]);
+                }
+            }
+        }
+
+        /* Leaf comparison, as in search_patricia. */
+        for (unsigned k = 0; k < g; ++k) {
+            batch_lane_t *l = &lanes[k];
+            search_stats_t *out = &stats[base + k];
+            uint32_t landing = LEAF_INDEX(l->ref);
+            out->node_comparisons++;           /* landing leaf */
+            out->string_comparisons++;
+            strcmp_bits_firstdiff(l->query, leaf_key(t, landing), &out->bit_comparisons);
+            results_push_leaf(out, t, landing);
+        }
+    }
+}
+
+unsigned search_patricia_topk(patricia_tree_t *t, const char *query,
+                              unsigned k, int max_distance,
+                              fuzzy_match_t *matches, search_stats_t *out) {
+    stats_init(out);
+    if (!t || t->root == PAT_NIL || k == 0U || max_distance < 0) return 0U;
 
-    /* Walk while caching path (for mismatch node). */
-    pnode_t *path[512]; unsigned depth = 0U;
-    pnode_t *node = t->root;
+    /* Same counted descent as search_patricia. */
+    descend(t, query, out);
 
-    while (node && !node->is_leaf) {
+    /* The k closest keys can sit anywhere, so the walk starts at the root;
+       the bound keeps it to the part of the trie within reach. */
+    fuzzy_scan_t fs;
+    fuzzy_scan_init(&fs, t, query, k, max_distance);
+    dfs_best_leaf_no_count(&fs, t->root, 0);
+    if (fs.npending) flush_pending(&fs);
+
+    /* Pop the heap worst-first to lay matches out best-first. */
+    unsigned n = fs.heap_size;
+    for (unsigned i = n; i-- > 0U; ) {
+        fuzzy_cand_t c = fs.heap[0];
+        fs.heap[0] = fs.heap[--fs.heap_size];
+        heap_sift_down(&fs, 0U);
+        matches[i].key      = leaf_key(t, c.leaf);
+        matches[i].distance = c.d;
+        matches[i].leaf     = c.leaf;
+    }
+    fuzzy_scan_free(&fs);
+
+    for (unsigned i = 0; i < n; ++i) {
+        matches[i].first = out->result_count;
+        results_push_leaf(out, t, matches[i].leaf);
+        matches[i].count = out->result_count - matches[i].first;
+    }
+    return n;
+}
+
+/* ---------- Prefix search ---------- */
+
+/* Row ids of a leaf */
+static const row_id_t *leaf_rows(const patricia_tree_t *t, uint32_t leaf,
+                                 unsigned *count) {
+    if (t->is_image) {
+        *count = t->img.leaves[leaf].count;
+        return &t->img.leaf_rows[t->img.leaves[leaf].first];
+    }
+    *count = t->leaves[leaf].count;
+    return t->leaves[leaf].rows;
+}
+
+/* In-order walk of a subtree: child[0] before child[1] is key order.
+   Counts the keys handed to fn; returns 0 once fn asks to stop. */
+static int prefix_walk(const patricia_tree_t *t, uint32_t ref,
+                       patricia_prefix_fn fn, void *ctx, unsigned *keys) {
+    while (!IS_LEAF(ref)) {
+        if (!prefix_walk(t, t->inner[ref].child[0], fn, ctx, keys)) return 0;
+        ref = t->inner[ref].child[1];
+    }
+    unsigned count;
+    const row_id_t *rows = leaf_rows(t, LEAF_INDEX(ref), &count);
+    (*keys)++;
+    return fn(ctx, leaf_key(t, LEAF_INDEX(ref)), rows, count);
+}
+
+unsigned patricia_prefix_each(patricia_tree_t *t, const char *prefix,
+                              patricia_prefix_fn fn, void *ctx,
+                              search_stats_t *out) {
+    stats_init(out);
+    if (!t || t->root == PAT_NIL) return 0U;
+
+    /* Follow the prefix's bits only while the branch bit lies inside it;
+       every key below the stopping point agrees on all of those bits. */
+    size_t plen = strlen(prefix);
+    unsigned int pbits = (unsigned int)(plen * BITS_PER_BYTE);
+    uint32_t ref = t->root;
+    while (!IS_LEAF(ref) && t->inner[ref].bitIndex < pbits) {
         out->node_comparisons++;
-        path[depth++] = node;
-        int bit = getBit((char*)query, node->bitIndex);
-        node = (bit == 0 ? node->left : node->right);
+        ref = t->inner[ref].child[bit_at(prefix, t->inner[ref].bitIndex)];
     }
-    if (node) { out->node_comparisons++; path[depth++] = node; }
+    uint32_t top = ref;
 
-    /* One string comparison updates bit counter. */
+    /* Untested bits may still differ: check the prefix against one key of
+       the subtree (its leftmost leaf). */
+    while (!IS_LEAF(ref)) {
+        out->node_comparisons++;
+        ref = t->inner[ref].child[0];
+    }
+    out->node_comparisons++;                /* representative leaf */
     out->string_comparisons++;
-    int cmp = strcmp_bits_firstdiff(query, node->key, &out->bit_comparisons);
-    if (cmp == 0) { results_push_leaf(out, node); return; }
-
-    /* Choose mismatch node (prefer exact bit match, else deepest < diff). */
-    unsigned int diff_bit = first_diff_bit_pos(query, node->key);
-    pnode_t *mismatch = NULL;
-    for (int i = (int)depth - 1; i >= 0; --i) {
-        pnode_t *n = path[i];
-        if (!n->is_leaf && n->bitIndex == diff_bit) { mismatch = n; break; }
-    }
-    if (!mismatch) {
-        for (int i = (int)depth - 1; i >= 0 && !mismatch; --i) {
-            pnode_t *n = path[i];
-            if (!n->is_leaf && n->bitIndex < diff_bit) { mismatch = n; break; }
+    const char *key = leaf_key(t, LEAF_INDEX(ref));
+    size_t i = first_diff_byte(prefix, key);
+    if (i < plen) {
+        out->bit_comparisons += 8ULL * i
+            + byte_diff_bit((unsigned char)prefix[i], (unsigned char)key[i]) + 1;
+        return 0U;
+    }
+    out->bit_comparisons += 8ULL * plen;
+
+    unsigned keys = 0U;
+    prefix_walk(t, top, fn, ctx, &keys);
+    return keys;
+}
+
+/* Collects rows for search_patricia_prefix */
+typedef struct prefix_collect {
+    search_stats_t *out;
+    unsigned        limit;          /* 0 = no limit */
+} prefix_collect_t;
+
+static int collect_rows(void *ctx, const char *key, const row_id_t *rows,
+                        unsigned count) {
+    prefix_collect_t *pc = ctx;
+    (void)key;
+    for (unsigned i = 0; i < count; ++i) {
+        if (pc->limit && pc->out->result_count >= pc->limit) return 0;
+        push_result(pc->out, rows[i]);
+    }
+    return !pc->limit || pc->out->result_count < pc->limit;
+}
+
+void search_patricia_prefix(patricia_tree_t *t, const char *prefix,
+                            unsigned limit, search_stats_t *out) {
+    prefix_collect_t pc = { out, limit };
+    patricia_prefix_each(t, prefix, collect_rows, &pc, out);
+}
+
+/* ---------- Ordered cursor ---------- */
+
+/* One step of the root-to-leaf path: an internal node and the child taken */
+typedef struct cursor_step {
+    uint32_t node;
+    uint32_t dir;
+} cursor_step_t;
+
+struct patricia_cursor {
+    const patricia_tree_t *t;
+    cursor_step_t *path;            /* explicit stack, root first */
+    unsigned       depth, cap;
+    uint32_t       leaf;            /* current leaf index, PAT_NIL if none */
+};
+
+patricia_cursor_t *patricia_cursor_open(const patricia_tree_t *t) {
+    patricia_cursor_t *c = calloc(1, sizeof *c);
+    if (!c) return NULL;
+    c->t = t;
+    c->cap = 32U;
+    c->path = malloc(c->cap * sizeof *c->path);
+    if (!c->path) { free(c); return NULL; }
+    c->leaf = PAT_NIL;
+    return c;
+}
+
+void patricia_cursor_close(patricia_cursor_t *c) {
+    if (!c) return;
+    free(c->path);
+    free(c);
+}
+
+static void cursor_push(patricia_cursor_t *c, uint32_t node, uint32_t dir) {
+    if (c->depth == c->cap) {
+        c->cap *= 2U;
+        c->path = realloc(c->path, c->cap * sizeof *c->path);
+        assert(c->path);
+    }
+    c->path[c->depth].node = node;
+    c->path[c->depth].dir  = dir;
+    c->depth++;
+}
+
+/* Descend from ref always taking child[dir] (0 = leftmost leaf, 1 =
+   rightmost), adding the nodes to the path. Returns the nodes visited. */
+static unsigned cursor_edge(patricia_cursor_t *c, uint32_t ref, uint32_t dir) {
+    unsigned visited = 1U;
+    while (!IS_LEAF(ref)) {
+        cursor_push(c, ref, dir);
+        ref = c->t->inner[ref].child[dir];
+        visited++;
+    }
+    c->leaf = LEAF_INDEX(ref);
+    return visited;
+}
+
+int patricia_cursor_first(patricia_cursor_t *c) {
+    c->depth = 0U;
+    c->leaf = PAT_NIL;
+    if (!c->t || c->t->root == PAT_NIL) return 0;
+    cursor_edge(c, c->t->root, 0U);
+    return 1;
+}
+
+int patricia_cursor_last(patricia_cursor_t *c) {
+    c->depth = 0U;
+    c->leaf = PAT_NIL;
+    if (!c->t || c->t->root == PAT_NIL) return 0;
+    cursor_edge(c, c->t->root, 1U);
+    return 1;
+}
+
+/* Move to the neighbouring leaf in direction dir (1 = next, 0 = previous):
+   climb to the nearest node left through the other child, cross over, then
+   descend to the closest leaf on that side. */
+static int cursor_step(patricia_cursor_t *c, uint32_t dir) {
+    if (c->leaf == PAT_NIL) return 0;
+    while (c->depth > 0U && c->path[c->depth - 1U].dir == dir) c->depth--;
+    if (c->depth == 0U) { c->leaf = PAT_NIL; return 0; }
+    cursor_step_t *top = &c->path[c->depth - 1U];
+    top->dir = dir;
+    cursor_edge(c, c->t->inner[top->node].child[dir], !dir);
+    return 1;
+}
+
+int patricia_cursor_next(patricia_cursor_t *c) {
+    return cursor_step(c, 1U);
+}
+
+int patricia_cursor_prev(patricia_cursor_t *c) {
+    return cursor_step(c, 0U);
+}
+
+int patricia_cursor_seek(patricia_cursor_t *c, const char *key,
+                         search_stats_t *out) {
+    const patricia_tree_t *t = c->t;
+    c->depth = 0U;
+    c->leaf = PAT_NIL;
+    if (!t || t->root == PAT_NIL) return 0;
+
+    /* Plain descent on key's bits (past its end they read as 0) */
+    size_t klen = strlen(key);
+    uint32_t ref = t->root;
+    while (!IS_LEAF(ref)) {
+        if (out) out->node_comparisons++;
+        int bit = bit_at_len(key, klen, t->inner[ref].bitIndex);
+        cursor_push(c, ref, (uint32_t)bit);
+        ref = t->inner[ref].child[bit];
+    }
+    if (out) out->node_comparisons++;
+    c->leaf = LEAF_INDEX(ref);
+
+    unsigned long long bits = 0ULL;
+    int cmp = strcmp_bits_firstdiff(key, leaf_key(t, c->leaf), &bits);
+    if (out) {
+        out->string_comparisons++;
+        out->bit_comparisons += bits;
+    }
+    if (cmp == 0) return 1;
+
+    /* Every key under the highest path node branching past the first
+       differing bit shares that bit with the landing leaf, so the whole
+       subtree sorts on one side of key. */
+    unsigned int d = first_diff_bit_pos(key, leaf_key(t, c->leaf));
+    unsigned keep = 0U;
+    while (keep < c->depth && t->inner[c->path[keep].node].bitIndex < d) keep++;
+    uint32_t sub = keep ? t->inner[c->path[keep - 1U].node].child[c->path[keep - 1U].dir]
+                        : t->root;
+    c->depth = keep;
+
+    unsigned visited;
+    if (cmp < 0) {
+        visited = cursor_edge(c, sub, 0U);      /* subtree > key: its first */
+        if (out) out->node_comparisons += visited;
+        return 1;
+    }
+    visited = cursor_edge(c, sub, 1U);          /* subtree < key: after its last */
+    if (out) out->node_comparisons += visited;
+    return patricia_cursor_next(c);
+}
+
+int patricia_cursor_valid(const patricia_cursor_t *c) {
+    return c->leaf != PAT_NIL;
+}
+
+const char *patricia_cursor_key(const patricia_cursor_t *c) {
+    return c->leaf == PAT_NIL ? NULL : leaf_key(c->t, c->leaf);
+}
+
+const row_id_t *patricia_cursor_rows(const patricia_cursor_t *c, unsigned *count) {
+    if (c->leaf == PAT_NIL) { *count = 0U; return NULL; }
+    return leaf_rows(c->t, c->leaf, count);
+}
+
+void search_patricia_range(patricia_tree_t *t, const char *lo, const char *hi,
+                           unsigned limit, search_stats_t *out) {
+    stats_init(out);
+    patricia_cursor_t *c = patricia_cursor_open(t);
+    assert(c);
+    int ok = patricia_cursor_seek(c, lo, out);
+    while (ok && (!limit || out->result_count < limit)) {
+        if (hi) {
+            out->string_comparisons++;
+            if (strcmp(patricia_cursor_key(c), hi) >= 0) break;
         }
-        if (!mismatch) mismatch = t->root;
+        unsigned count;
+        const row_id_t *rows = patricia_cursor_rows(c, &count);
+        for (unsigned i = 0; i < count && (!limit || out->result_count < limit); ++i) {
+            push_result(out, rows[i]);
+        }
+        ok = patricia_cursor_next(c);
+    }
+    patricia_cursor_close(c);
+}
+
+/* ---------- Statistics ---------- */
+
+/* Bucket of a rows-per-leaf count: floor(log2(count)) */
+static unsigned dup_bucket(unsigned count) {
+    unsigned k = 0U;
+    while (count > 1U && k < PAT_STATS_DUPS - 1U) { count >>= 1; k++; }
+    return k;
+}
+
+/* Count and size the leaves, pools and free lists (everything except depth) */
+static void stats_leaves(const patricia_tree_t *t, patricia_stats_t *st) {
+    if (t->is_image) {
+        st->leaves = t->img.leaf_count;
+        st->rows = t->img.leaf_row_count;
+        st->inner_bytes = (size_t)t->img.inner_count * sizeof *t->img.inner;
+        st->leaf_bytes = (size_t)t->img.leaf_count * sizeof *t->img.leaves;
+        st->row_bytes = (size_t)t->img.leaf_row_count * sizeof *t->img.leaf_rows;
+        st->inner_nodes = t->img.inner_count;
+        return;
+    }
+    for (uint32_t i = t->free_inner; i != PAT_NIL; i = t->inner[i].child[0]) {
+        st->free_inner++;
     }
+    for (uint32_t i = 0; i < t->leaf_count; ++i) {
+        const pleaf_t *l = &t->leaves[i];
+        if (!l->key) { st->free_leaves++; continue; }
+        st->leaves++;
+        st->rows += l->count;
+        st->key_bytes += strlen(l->key) + 1U;
+        st->row_bytes += (size_t)l->count * sizeof *l->rows;
+        st->row_slack_bytes += (size_t)(l->cap - l->count) * sizeof *l->rows;
+    }
+    st->inner_nodes = t->inner_count - st->free_inner;
+    st->inner_bytes = (size_t)t->inner_cap * sizeof *t->inner;
+    st->leaf_bytes = (size_t)t->leaf_cap * sizeof *t->leaves;
+    st->pool_slack_bytes = (t->inner_cap - st->inner_nodes) * sizeof *t->inner
+                         + (t->leaf_cap - st->leaves) * sizeof *t->leaves;
+}
 
-    /* Scan descendants (no counters) and pick best leaf. */
-    pnode_t *best = NULL; int bestd = INT_MAX;
-    dfs_best_leaf_no_count(mismatch, query, &best, &bestd);
+int patricia_get_stats(const patricia_tree_t *t, patricia_stats_t *st) {
+    memset(st, 0, sizeof *st);
+    st->is_image = t->is_image;
+    stats_leaves(t, st);
+    st->total_bytes = sizeof *t + st->inner_bytes + st->leaf_bytes + st->key_bytes
+                    + st->row_bytes + st->row_slack_bytes;
+    if (t->root == PAT_NIL) return 0;
 
-    /* IMPORTANT: Mirror working code: if best exists, push the LANDING leaf (node), not best. */
-    if (best) results_push_leaf(out, node);
+    /* Depth-first walk with an explicit (reference, depth) stack; it never
+       holds more than one pending sibling per level */
+    size_t cap = 64U, top = 0U;
+    uint32_t *stack = malloc(cap * 2U * sizeof *stack);
+    if (!stack) return -1;
+    double depth_sum = 0.0, row_depth_sum = 0.0;
+    stack[0] = t->root;
+    stack[1] = 1U;
+    top = 1U;
+    while (top > 0U) {
+        top--;
+        uint32_t ref = stack[2U * top], depth = stack[2U * top + 1U];
+        while (!IS_LEAF(ref)) {
+            if (top == cap) {
+                cap *= 2U;
+                uint32_t *tmp = realloc(stack, cap * 2U * sizeof *stack);
+                if (!tmp) { free(stack); return -1; }
+                stack = tmp;
+            }
+            depth++;
+            stack[2U * top] = t->inner[ref].child[1];
+            stack[2U * top + 1U] = depth;
+            top++;
+            ref = t->inner[ref].child[0];
+        }
+        unsigned count;
+        leaf_rows(t, LEAF_INDEX(ref), &count);
+        st->depth_hist[depth < PAT_STATS_DEPTHS ? depth : PAT_STATS_DEPTHS - 1U]++;
+        if (depth > st->max_depth) st->max_depth = depth;
+        depth_sum += depth;
+        row_depth_sum += (double)depth * count;
+        st->dup_hist[dup_bucket(count)]++;
+        if (count > st->max_dups) st->max_dups = count;
+    }
+    free(stack);
+    if (st->leaves) st->avg_depth = depth_sum / (double)st->leaves;
+    if (st->rows) st->avg_row_depth = row_depth_sum / (double)st->rows;
+    return 0;
+}
+
+void patricia_print_stats(const patricia_stats_t *st, FILE *out) {
+    fprintf(out, "Patricia tree%s\n", st->is_image ? " (snapshot image, borrowed)" : "");
+    fprintf(out, "  nodes: %zu branch, %zu leaf (distinct keys), %zu rows",
+            st->inner_nodes, st->leaves, st->rows);
+    if (st->free_inner || st->free_leaves) {
+        fprintf(out, "; free: %zu branch, %zu leaf", st->free_inner, st->free_leaves);
+    }
+    fprintf(out, "\n  bytes: %zu total\n", st->total_bytes);
+    fprintf(out, "    branch nodes  %12zu\n", st->inner_bytes);
+    fprintf(out, "    leaves        %12zu\n", st->leaf_bytes);
+    fprintf(out, "    keys          %12zu\n", st->key_bytes);
+    fprintf(out, "    leaf rows     %12zu\n", st->row_bytes);
+    fprintf(out, "    rows slack    %12zu  (cap - count)\n", st->row_slack_bytes);
+    fprintf(out, "    pool slack    %12zu  (included in branch nodes/leaves)\n",
+            st->pool_slack_bytes);
+    fprintf(out, "  descent length (nodes, leaf included): avg %.2f per key, "
+                 "%.2f per row, max %u\n",
+            st->avg_depth, st->avg_row_depth, st->max_depth);
+    for (unsigned d = 0; d < PAT_STATS_DEPTHS; ++d) {
+        if (!st->depth_hist[d]) continue;
+        fprintf(out, "    %s%3u  %zu\n", d == PAT_STATS_DEPTHS - 1U ? ">=" : "  ",
+                d, st->depth_hist[d]);
+    }
+    fprintf(out, "  rows per leaf: max %u\n", st->max_dups);
+    for (unsigned k = 0; k < PAT_STATS_DUPS; ++k) {
+        if (!st->dup_hist[k]) continue;
+        unsigned long lo = 1UL << k;
+        if (k == PAT_STATS_DUPS - 1U) fprintf(out, "    >=%lu", lo);
+        else if (lo == 1UL) fprintf(out, "    1");
+        else fprintf(out, "    %lu-%lu", lo, 2UL * lo - 1UL);
+        fprintf(out, "  %zu\n", st->dup_hist[k]);
+    }
 }
@@ -1,55 +1,171 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "print.h"
 #include "utils.h"
+#include "metrics.h"
 
 #define SAFE_STR(s) ((s) ? (s) : "")
 
-/* Column headers in the exact dataset order */
-static const char *HEADERS[35] = {
-  "PFI","EZI_ADD","SRC_VERIF","PROPSTATUS","GCODEFEAT","LOC_DESC",
-  "BLGUNTTYP","HSAUNITID","BUNIT_PRE1","BUNIT_ID1","BUNIT_SUF1",
-  "BUNIT_PRE2","BUNIT_ID2","BUNIT_SUF2","FLOOR_TYPE","FLOOR_NO_1",
-  "FLOOR_NO_2","BUILDING","COMPLEX","HSE_PREF1","HSE_NUM1","HSE_SUF1",
-  "HSE_PREF2","HSE_NUM2","HSE_SUF2","DISP_NUM1","ROAD_NAME","ROAD_TYPE",
-  "RD_SUF","LOCALITY","STATE","POSTCODE","ACCESSTYPE","x","y"
+/* Text written before each field: "--> PFI: ", " || EZI_ADD: ", ...
+   in the exact dataset order, lengths computed at compile time */
+#define FRAG(s) { s, sizeof(s) - 1 }
+static const struct { const char *s; size_t n; } FRAGMENTS[35] = {
+  FRAG("--> PFI: "), FRAG(" || EZI_ADD: "), FRAG(" || SRC_VERIF: "),
+  FRAG(" || PROPSTATUS: "), FRAG(" || GCODEFEAT: "), FRAG(" || LOC_DESC: "),
+  FRAG(" || BLGUNTTYP: "), FRAG(" || HSAUNITID: "), FRAG(" || BUNIT_PRE1: "),
+  FRAG(" || BUNIT_ID1: "), FRAG(" || BUNIT_SUF1: "), FRAG(" || BUNIT_PRE2: "),
+  FRAG(" || BUNIT_ID2: "), FRAG(" || BUNIT_SUF2: "), FRAG(" || FLOOR_TYPE: "),
+  FRAG(" || FLOOR_NO_1: "), FRAG(" || FLOOR_NO_2: "), FRAG(" || BUILDING: "),
+  FRAG(" || COMPLEX: "), FRAG(" || HSE_PREF1: "), FRAG(" || HSE_NUM1: "),
+  FRAG(" || HSE_SUF1: "), FRAG(" || HSE_PREF2: "), FRAG(" || HSE_NUM2: "),
+  FRAG(" || HSE_SUF2: "), FRAG(" || DISP_NUM1: "), FRAG(" || ROAD_NAME: "),
+  FRAG(" || ROAD_TYPE: "), FRAG(" || RD_SUF: "), FRAG(" || LOCALITY: "),
+  FRAG(" || STATE: "), FRAG(" || POSTCODE: "), FRAG(" || ACCESSTYPE: "),
+  FRAG(" || x: "), FRAG(" || y: ")
 };
 
+/* ---------- Output buffer ---------- */
+
+void out_init(out_buf_t *b, int fd, FILE *fp){
+    b->data = NULL;
+    b->len = b->cap = 0;
+    b->fd = fd;
+    b->fp = fp;
+}
+
+/* make room for n more bytes */
+static void out_reserve(out_buf_t *b, size_t n){
+    if (b->len + n <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n) cap *= 2;
+    b->data = realloc(b->data, cap);
+    assert(b->data);
+    b->cap = cap;
+}
+
+void out_put(out_buf_t *b, const char *s, size_t n){
+    out_reserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+void out_puts(out_buf_t *b, const char *s){
+    out_put(b, s, strlen(s));
+}
+
+void out_flush(out_buf_t *b){
+    if (b->fd < 0 && !b->fp) return;            // Memory-only buffer
+    phase_mark_t mark = phase_begin();
+    if (b->fd >= 0) {
+        size_t done = 0;
+        while (done < b->len) {
+            ssize_t w = write(b->fd, b->data + done, b->len - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) break;                  // Sink failed; drop the rest
+            done += (size_t)w;
+        }
+    } else {
+        fwrite(b->data, 1, b->len, b->fp);
+    }
+    b->len = 0;
+    phase_end(PHASE_WRITE, mark);
+}
+
+void out_maybe_flush(out_buf_t *b){
+    if (b->len >= OUT_FLUSH_BYTES) out_flush(b);
+}
+
+void out_free(out_buf_t *b){
+    out_flush(b);
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+/* ---------- Record formatting ---------- */
+
+/* Append v as printf("%Lf") would: six decimals, correctly rounded. The
+   common case is done in fixed point; values whose scaled fraction lies
+   too close to a rounding tie (or that are huge, tiny negative, or not
+   finite) go through snprintf so the text stays byte-identical. */
+static void put_coord(out_buf_t *b, long double v){
+    long double scaled = v * 1e6L;
+    if (scaled < 9e15L && scaled > -9e15L && v != 0) {
+        int neg = scaled < 0;
+        long double mag = neg ? -scaled : scaled;
+        unsigned long long whole = (unsigned long long)mag;
+        long double frac = mag - (long double)whole;
+        if ((frac < 0.5L - 1e-6L || frac > 0.5L + 1e-6L) &&
+            !(neg && whole == 0 && frac < 0.5L)) {
+            unsigned long long units = whole + (frac > 0.5L);
+            char tmp[32];
+            int p = sizeof(tmp);
+            for (int i = 0; i < 6; i++) { tmp[--p] = (char)('0' + units % 10); units /= 10; }
+            tmp[--p] = '.';
+            do { tmp[--p] = (char)('0' + units % 10); units /= 10; } while (units);
+            if (neg) tmp[--p] = '-';
+            out_put(b, tmp + p, sizeof(tmp) - (size_t)p);
+            return;
+        }
+    }
+    char tmp[64];
+    int n = snprintf(tmp, sizeof(tmp), "%Lf", v);
+    if (n > 0 && (size_t)n < sizeof(tmp)) out_put(b, tmp, (size_t)n);
+    else {
+        char *big = malloc((size_t)n + 1);
+        assert(big);
+        snprintf(big, (size_t)n + 1, "%Lf", v);
+        out_put(b, big, (size_t)n);
+        free(big);
+    }
+}
+
+/* append one record from its string fields and coordinates */
+static void format_fields(out_buf_t *b, const char *const f[ROW_STR_FIELDS],
+                          long double x, long double y){
+    for (int i = 0; i < ROW_STR_FIELDS; i++) {
+        const char *s = SAFE_STR(f[i]);
+        size_t n = strlen(s);
+        out_reserve(b, FRAGMENTS[i].n + n);
+        memcpy(b->data + b->len, FRAGMENTS[i].s, FRAGMENTS[i].n);
+        memcpy(b->data + b->len + FRAGMENTS[i].n, s, n);
+        b->len += FRAGMENTS[i].n + n;
+    }
+    out_put(b, FRAGMENTS[33].s, FRAGMENTS[33].n);
+    put_coord(b, x);
+    out_put(b, FRAGMENTS[34].s, FRAGMENTS[34].n);
+    put_coord(b, y);
+    out_put(b, "\n", 1);
+}
+
 /* print a single record */
 void print_record(FILE *out, const row_t *a){
-    fprintf(out, "--> ");
-    fprintf(out, "%s: %s || ",  HEADERS[0],  SAFE_STR(a->PFI));
-    fprintf(out, "%s: %s || ",  HEADERS[1],  SAFE_STR(a->EZI_ADD));
-    fprintf(out, "%s: %s || ",  HEADERS[2],  SAFE_STR(a->SRC_VERIF));
-    fprintf(out, "%s: %s || ",  HEADERS[3],  SAFE_STR(a->PROPSTATUS));
-    fprintf(out, "%s: %s || ",  HEADERS[4],  SAFE_STR(a->GCODEFEAT));
-    fprintf(out, "%s: %s || ",  HEADERS[5],  SAFE_STR(a->LOC_DESC));
-    fprintf(out, "%s: %s || ",  HEADERS[6],  SAFE_STR(a->BLGUNTTYP));
-    fprintf(out, "%s: %s || ",  HEADERS[7],  SAFE_STR(a->HSAUNITID));
-    fprintf(out, "%s: %s || ",  HEADERS[8],  SAFE_STR(a->BUNIT_PRE1));
-    fprintf(out, "%s: %s || ",  HEADERS[9],  SAFE_STR(a->BUNIT_ID1));
-    fprintf(out, "%s: %s || ",  HEADERS[10], SAFE_STR(a->BUNIT_SUF1));
-    fprintf(out, "%s: %s || ",  HEADERS[11], SAFE_STR(a->BUNIT_PRE2));
-    fprintf(out, "%s: %s || ",  HEADERS[12], SAFE_STR(a->BUNIT_ID2));
-    fprintf(out, "%s: %s || ",  HEADERS[13], SAFE_STR(a->BUNIT_SUF2));
-    fprintf(out, "%s: %s || ",  HEADERS[14], SAFE_STR(a->FLOOR_TYPE));
-    fprintf(out, "%s: %s || ",  HEADERS[15], SAFE_STR(a->FLOOR_NO_1));
-    fprintf(out, "%s: %s || ",  HEADERS[16], SAFE_STR(a->FLOOR_NO_2));
-    fprintf(out, "%s: %s || ",  HEADERS[17], SAFE_STR(a->BUILDING));
-    fprintf(out, "%s: %s || ",  HEADERS[18], SAFE_STR(a->COMPLEX));
-    fprintf(out, "%s: %s || ",  HEADERS[19], SAFE_STR(a->HSE_PREF1));
-    fprintf(out, "%s: %s || ",  HEADERS[20], SAFE_STR(a->HSE_NUM1));
-    fprintf(out, "%s: %s || ",  HEADERS[21], SAFE_STR(a->HSE_SUF1));
-    fprintf(out, "%s: %s || ",  HEADERS[22], SAFE_STR(a->HSE_PREF2));
-    fprintf(out, "%s: %s || ",  HEADERS[23], SAFE_STR(a->HSE_NUM2));
-    fprintf(out, "%s: %s || ",  HEADERS[24], SAFE_STR(a->HSE_SUF2));
-    fprintf(out, "%s: %s || ",  HEADERS[25], SAFE_STR(a->DISP_NUM1));
-    fprintf(out, "%s: %s || ",  HEADERS[26], SAFE_STR(a->ROAD_NAME));
-    fprintf(out, "%s: %s || ",  HEADERS[27], SAFE_STR(a->ROAD_TYPE));
-    fprintf(out, "%s: %s || ",  HEADERS[28], SAFE_STR(a->RD_SUF));
-    fprintf(out, "%s: %s || ",  HEADERS[29], SAFE_STR(a->LOCALITY));
-    fprintf(out, "%s: %s || ",  HEADERS[30], SAFE_STR(a->STATE));
-    fprintf(out, "%s: %s || ",  HEADERS[31], SAFE_STR(a->POSTCODE));
-    fprintf(out, "%s: %s || ",  HEADERS[32], SAFE_STR(a->ACCESSTYPE));
-    fprintf(out, "%s: %Lf || ", HEADERS[33], a->x);
-    fprintf(out, "%s: %Lf\n",   HEADERS[34], a->y);
+    char **fields[ROW_STR_FIELDS];
+    const char *f[ROW_STR_FIELDS];
+    row_fields((row_t *)a, fields);
+    for (int i = 0; i < ROW_STR_FIELDS; i++) f[i] = *fields[i];
+
+    out_buf_t b;
+    out_init(&b, -1, out);
+    format_fields(&b, f, a->x, a->y);
+    out_free(&b);
+}
+
+/* append row id, reading through the columnar store if there is one */
+void format_row(out_buf_t *b, const row_source_t *src, row_id_t id){
+    const char *f[ROW_STR_FIELDS];
+    if (!src->store) {
+        const row_t *a = &src->rows[id];
+        char **fields[ROW_STR_FIELDS];
+        row_fields((row_t *)a, fields);
+        for (int i = 0; i < ROW_STR_FIELDS; i++) f[i] = *fields[i];
+        format_fields(b, f, a->x, a->y);
+        return;
+    }
+    for (int i = 0; i < ROW_STR_FIELDS; i++) f[i] = colstore_field(src->store, id, i);
+    format_fields(b, f, colstore_x(src->store, id), colstore_y(src->store, id));
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qcache.h"
+
+/* One cached answer; entries sit on a hash chain and on the LRU list */
+typedef struct qentry {
+    struct qentry     *hnext;           /* hash chain */
+    struct qentry     *prev, *next;     /* LRU list, most recent at head */
+    uint32_t           hash;
+    size_t             bytes;           /* charged against the cap */
+    unsigned int       result_count;
+    unsigned long long bit_comparisons;
+    unsigned int       node_comparisons;
+    unsigned int       string_comparisons;
+    row_id_t          *results;
+    int               *distances;       /* per result, or NULL */
+    char               key[];           /* query string */
+} qentry_t;
+
+struct query_cache {
+    query_fn         fn;
+    void            *index;
+    size_t           max_bytes, bytes;
+    qentry_t       **buckets;
+    size_t           mask;              /* bucket count - 1 */
+    size_t           count;
+    qentry_t        *head, *tail;       /* LRU list */
+    unsigned long long hits, misses, evictions;
+    pthread_mutex_t  lock;
+};
+
+static uint32_t hash_query(const char *s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+query_cache_t *create_query_cache(query_fn fn, void *index, size_t max_bytes) {
+    query_cache_t *c = calloc(1, sizeof *c);
+    if (!c) return NULL;
+    c->fn = fn;
+    c->index = index;
+    c->max_bytes = max_bytes;
+    c->mask = 1023;
+    c->buckets = calloc(c->mask + 1, sizeof *c->buckets);
+    if (!c->buckets) { free(c); return NULL; }
+    pthread_mutex_init(&c->lock, NULL);
+    return c;
+}
+
+void free_query_cache(query_cache_t *c) {
+    if (!c) return;
+    for (qentry_t *e = c->head; e; ) {
+        qentry_t *next = e->next;
+        free(e->results);
+        free(e->distances);
+        free(e);
+        e = next;
+    }
+    free(c->buckets);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+static void lru_unlink(query_cache_t *c, qentry_t *e) {
+    if (e->prev) e->prev->next = e->next; else c->head = e->next;
+    if (e->next) e->next->prev = e->prev; else c->tail = e->prev;
+}
+
+static void lru_push_front(query_cache_t *c, qentry_t *e) {
+    e->prev = NULL;
+    e->next = c->head;
+    if (c->head) c->head->prev = e; else c->tail = e;
+    c->head = e;
+}
+
+static qentry_t *find(const query_cache_t *c, const char *q, uint32_t h) {
+    for (qentry_t *e = c->buckets[h & c->mask]; e; e = e->hnext)
+        if (e->hash == h && strcmp(e->key, q) == 0) return e;
+    return NULL;
+}
+
+/* Drop the least recently used entry */
+static void evict_one(query_cache_t *c) {
+    qentry_t *e = c->tail;
+    lru_unlink(c, e);
+    qentry_t **pp = &c->buckets[e->hash & c->mask];
+    while (*pp != e) pp = &(*pp)->hnext;
+    *pp = e->hnext;
+    c->bytes -= e->bytes;
+    c->count--;
+    c->evictions++;
+    free(e->results);
+    free(e->distances);
+    free(e);
+}
+
+/* Double the bucket array once chains average more than one entry */
+static void maybe_grow(query_cache_t *c) {
+    if (c->count <= c->mask) return;
+    size_t nmask = c->mask * 2 + 1;
+    qentry_t **nb = calloc(nmask + 1, sizeof *nb);
+    if (!nb) return;                    /* keep the longer chains */
+    for (size_t i = 0; i <= c->mask; i++) {
+        for (qentry_t *e = c->buckets[i], *next; e; e = next) {
+            next = e->hnext;
+            e->hnext = nb[e->hash & nmask];
+            nb[e->hash & nmask] = e;
+        }
+    }
+    free(c->buckets);
+    c->buckets = nb;
+    c->mask = nmask;
+}
+
+static void insert(query_cache_t *c, const char *q, uint32_t h,
+                   const search_stats_t *st) {
+    size_t klen = strlen(q) + 1;
+    size_t dist_bytes = st->distances ? st->result_count * sizeof(int) : 0;
+    size_t bytes = sizeof(qentry_t) + klen + st->result_count * sizeof(row_id_t) + dist_bytes;
+    if (bytes > c->max_bytes || find(c, q, h)) return;
+
+    qentry_t *e = malloc(sizeof *e + klen);
+    row_id_t *rows = NULL;
+    int *dist = NULL;
+    if (st->result_count) rows = malloc(st->result_count * sizeof *rows);
+    if (dist_bytes) dist = malloc(dist_bytes);
+    if (!e || (st->result_count && !rows) || (dist_bytes && !dist)) {
+        free(e); free(rows); free(dist); return;
+    }
+    memcpy(e->key, q, klen);
+    if (rows) memcpy(rows, st->results, st->result_count * sizeof *rows);
+    if (dist) memcpy(dist, st->distances, dist_bytes);
+    e->results = rows;
+    e->distances = dist;
+    e->hash = h;
+    e->bytes = bytes;
+    e->result_count = st->result_count;
+    e->bit_comparisons = st->bit_comparisons;
+    e->node_comparisons = st->node_comparisons;
+    e->string_comparisons = st->string_comparisons;
+
+    while (c->bytes + bytes > c->max_bytes) evict_one(c);
+    e->hnext = c->buckets[h & c->mask];
+    c->buckets[h & c->mask] = e;
+    lru_push_front(c, e);
+    c->bytes += bytes;
+    c->count++;
+    maybe_grow(c);
+}
+
+void cached_search(void *cache, const char *query, search_stats_t *st) {
+    query_cache_t *c = cache;
+    uint32_t h = hash_query(query);
+
+    pthread_mutex_lock(&c->lock);
+    qentry_t *e = find(c, query, h);
+    if (e) {
+        c->hits++;
+        lru_unlink(c, e);
+        lru_push_front(c, e);
+        st->result_count = st->capacity = e->result_count;
+        st->results = NULL;
+        if (e->result_count) {
+            st->results = malloc(e->result_count * sizeof *st->results);
+            assert(st->results);
+            memcpy(st->results, e->results, e->result_count * sizeof *st->results);
+        }
+        st->distances = NULL;
+        if (e->distances) {
+            st->distances = malloc(e->result_count * sizeof *st->distances);
+            assert(st->distances);
+            memcpy(st->distances, e->distances, e->result_count * sizeof *st->distances);
+        }
+        st->bit_comparisons = e->bit_comparisons;
+        st->node_comparisons = e->node_comparisons;
+        st->string_comparisons = e->string_comparisons;
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+    c->misses++;
+    pthread_mutex_unlock(&c->lock);
+
+    // Search outside the lock; a concurrent miss on the same query keeps
+    // whichever answer lands first
+    c->fn(c->index, query, st);
+
+    pthread_mutex_lock(&c->lock);
+    insert(c, query, h, st);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void query_cache_report(const query_cache_t *c, FILE *out) {
+    unsigned long long total = c->hits + c->misses;
+    fprintf(out, "Cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions, "
+                 "%zu entries, %zu/%zu bytes\n",
+            c->hits, c->misses, total ? 100.0 * (double)c->hits / (double)total : 0.0,
+            c->evictions, c->count, c->bytes, c->max_bytes);
+}
@@ -1,34 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "read.h"
 #include "csv.h"
-#include "list.h"
+#include "metrics.h"
 
-/* Read CSV file and convert to linked list */
-node_t *read_csv(const char *filename) {
-    FILE *fp = fopen(filename, "r");        // Open file for reading
-    if (!fp) return NULL;                   // Return NULL if file open fails
+/* Smallest slice of the file worth handing to a separate worker */
+#define MIN_CHUNK_BYTES (1u << 20)
+/* Upper bound on ingest worker threads */
+#define MAX_INGEST_THREADS 64
 
-    node_t *head = NULL, *tail = NULL;      // Linked list head and tail pointers
-    char line[1024];                        // Buffer for reading lines
+/* Load whole file into a NUL-terminated heap buffer (fallback when mmap fails) */
+static char *slurp_file(const char *filename, size_t *len) {
+    FILE *fp = fopen(filename, "rb");       // Open file for reading
+    if (!fp) return NULL;
+
+    char *buf = NULL;
+    size_t size = 0, cap = 0, got;
+    do {
+        // Grow buffer geometrically, keeping room for the terminator
+        if (cap - size < 4096) {
+            cap = cap ? cap * 2 : 65536;
+            char *tmp = realloc(buf, cap + 1);
+            if (!tmp) { free(buf); fclose(fp); return NULL; }
+            buf = tmp;
+        }
+        got = fread(buf + size, 1, cap - size, fp);
+        size += got;
+    } while (got > 0);
+
+    fclose(fp);
+    buf[size] = '\0';
+    *len = size;
+    return buf;
+}
+
+/* Map file copy-on-write so fields can be terminated in place */
+static char *map_file(const char *filename, size_t *len) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode) || sb.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, (size_t)sb.st_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE, fd, 0);
+    close(fd);                              // Mapping stays valid after close
+    if (p == MAP_FAILED) return NULL;
+
+    posix_madvise(p, (size_t)sb.st_size, POSIX_MADV_SEQUENTIAL);
+    *len = (size_t)sb.st_size;
+    return p;
+}
+
+/* Newline-aligned slice of the file handled by one worker */
+typedef struct ingest_chunk {
+    char        *begin;         // First byte of first line in chunk
+    char        *end;           // One past the '\n' of the last line
+    size_t       first;         // Index of the chunk's first row in the arena
+    size_t       lines;         // Number of lines in the chunk
+    csv_arena_t *arena;         // Destination rows/nodes
+} ingest_chunk_t;
+
+/* Count lines in a chunk (every line in it ends with '\n') */
+static void *count_chunk(void *arg) {
+    ingest_chunk_t *c = arg;
+    c->lines = 0;
+    for (char *q = c->begin; q < c->end; c->lines++) {
+        q = (char *)memchr(q, '\n', (size_t)(c->end - q)) + 1;
+    }
+    return NULL;
+}
+
+/* Parse one line into arena slot i and link it to slot i + 1 */
+static void parse_slot(csv_arena_t *arena, size_t i, char *line) {
+    // Remove newline/carriage return characters
+    line[strcspn(line, "\r\n")] = '\0';
+    parse_row_inplace(&arena->rows[i], line);
+    arena->nodes[i].data = &arena->rows[i];
+    arena->nodes[i].id = (row_id_t)i;
+    arena->nodes[i].next = (i + 1 < arena->count) ? &arena->nodes[i + 1] : NULL;
+}
+
+/* Parse every line of a chunk into its reserved range of rows */
+static void *parse_chunk(void *arg) {
+    ingest_chunk_t *c = arg;
+    size_t i = c->first;
+    for (char *q = c->begin; q < c->end; i++) {
+        char *nl = memchr(q, '\n', (size_t)(c->end - q));
+        *nl = '\0';
+        parse_slot(c->arena, i, q);
+        q = nl + 1;
+    }
+    return NULL;
+}
+
+/* Run fn over every chunk, one thread per chunk beyond the first */
+static void run_chunks(ingest_chunk_t *chunks, int n, void *(*fn)(void *)) {
+    pthread_t tid[MAX_INGEST_THREADS];
+    int started[MAX_INGEST_THREADS] = {0};
+
+    for (int k = 1; k < n; k++) {
+        started[k] = pthread_create(&tid[k], NULL, fn, &chunks[k]) == 0;
+        if (!started[k]) fn(&chunks[k]);    // Fall back to inline work
+    }
+    fn(&chunks[0]);                         // Calling thread takes chunk 0
+    for (int k = 1; k < n; k++) {
+        if (started[k]) pthread_join(tid[k], NULL);
+    }
+}
+
+/* Number of ingest workers for a body of len bytes */
+static int ingest_threads(size_t len) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    size_t by_size = len / MIN_CHUNK_BYTES + 1;
+    size_t n = (size_t)cpus < by_size ? (size_t)cpus : by_size;
+    return n > MAX_INGEST_THREADS ? MAX_INGEST_THREADS : (int)n;
+}
+
+/* Read CSV file into one (memory-mapped) buffer and parse rows in place.
+   The body is split into newline-aligned chunks that are counted and then
+   parsed in parallel; each chunk writes a reserved, contiguous range of
+   rows, so the list comes out in file order. */
+node_t *read_csv_arena(const char *filename, csv_arena_t *arena) {
+    memset(arena, 0, sizeof(*arena));
+    phase_mark_t mark = phase_begin();
+    arena->buf = map_file(filename, &arena->len);
+    if (arena->buf) {
+        arena->mapped = 1;
+    } else {
+        arena->buf = slurp_file(filename, &arena->len);
+        if (!arena->buf) return NULL;       // Return NULL if file read fails
+    }
+    phase_end(PHASE_READ, mark);
+    mark = phase_begin();
+
+    char *p = arena->buf, *end = arena->buf + arena->len;
 
     // Skip header row (first line)
-    if (!fgets(line, sizeof(line), fp)) {
-        fclose(fp);
-        return NULL;                        // Return NULL if file is empty
+    char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (!nl) { free_csv_arena(arena); return NULL; }
+    p = nl + 1;
+
+    // A last line without '\n' cannot be terminated inside the mapping,
+    // so it is copied out and parsed separately after the chunks
+    char *body_end = end;
+    if (p < end && end[-1] != '\n') {
+        char *last = end;
+        while (last > p && last[-1] != '\n') last--;
+        size_t n = (size_t)(end - last);
+        arena->tail = malloc(n + 1);
+        if (!arena->tail) { free_csv_arena(arena); return NULL; }
+        memcpy(arena->tail, last, n);
+        arena->tail[n] = '\0';
+        body_end = last;
     }
 
-    // Process each data row
-    while (fgets(line, sizeof(line), fp)) {
-        // Remove newline/carriage return characters
-        line[strcspn(line, "\r\n")] = '\0';
-        row_t *row = parse_row(line);       // Parse line into row structure
-        if (!row) continue;                 // Skip if parsing failed
-        node_t *node = create_node(row);    // Create linked list node
-        append_node(&head, &tail, node);    // Add node to end of list
+    // Split the body into newline-aligned chunks
+    ingest_chunk_t chunks[MAX_INGEST_THREADS];
+    int nchunks = ingest_threads((size_t)(body_end - p));
+    size_t step = (size_t)(body_end - p) / (size_t)nchunks;
+    char *cur = p;
+    for (int k = 0; k < nchunks; k++) {
+        char *stop = (k == nchunks - 1) ? body_end : cur + step;
+        if (stop < cur) stop = cur;
+        if (stop < body_end) {
+            nl = memchr(stop, '\n', (size_t)(body_end - stop));
+            stop = nl ? nl + 1 : body_end;
+        }
+        chunks[k].begin = cur;
+        chunks[k].end   = stop;
+        chunks[k].arena = arena;
+        cur = stop;
     }
 
-    fclose(fp);                             // Close the file
-    return head;                            // Return head of linked list
+    // Count lines per chunk, then reserve each chunk's range of rows
+    run_chunks(chunks, nchunks, count_chunk);
+    size_t total = 0;
+    for (int k = 0; k < nchunks; k++) {
+        chunks[k].first = total;
+        total += chunks[k].lines;
+    }
+    arena->count = total + (arena->tail ? 1 : 0);
+    if (arena->count == 0) { free_csv_arena(arena); return NULL; }
+
+    arena->rows  = malloc(arena->count * sizeof(*arena->rows));
+    arena->nodes = malloc(arena->count * sizeof(*arena->nodes));
+    if (!arena->rows || !arena->nodes) { free_csv_arena(arena); return NULL; }
+
+    // Process each data row
+    run_chunks(chunks, nchunks, parse_chunk);
+    if (arena->tail) parse_slot(arena, total, arena->tail);
+    phase_end(PHASE_PARSE, mark);
+
+    return arena->nodes;                    // Return head of linked list
+}
+
+/* Free arena buffers in one shot */
+void free_csv_arena(csv_arena_t *arena) {
+    if (!arena) return;
+    free(arena->nodes);
+    free(arena->rows);
+    free(arena->tail);
+    if (arena->mapped) munmap(arena->buf, arena->len);
+    else               free(arena->buf);
+    memset(arena, 0, sizeof(*arena));
 }
@@ -1,12 +1,10 @@
 #include <stdlib.h>
+#include <string.h>
 #include "row.h"
 
-/* Free memory allocated for a single row */
-void free_row(row_t *row) {
-    if (!row) return;                       // Do nothing for NULL row
-
-    // Array of pointers to all string fields for easy deallocation
-    char **fields[] = {
+/* Pointers to the string fields of a row, in dataset column order */
+void row_fields(row_t *row, char **fields[ROW_STR_FIELDS]) {
+    char **f[ROW_STR_FIELDS] = {
         &row->PFI, &row->EZI_ADD, &row->SRC_VERIF, &row->PROPSTATUS,
         &row->GCODEFEAT, &row->LOC_DESC, &row->BLGUNTTYP, &row->HSAUNITID,
         &row->BUNIT_PRE1, &row->BUNIT_ID1, &row->BUNIT_SUF1, &row->BUNIT_PRE2,
@@ -17,11 +15,18 @@ void free_row(row_t *row) {
         &row->RD_SUF, &row->LOCALITY, &row->STATE, &row->POSTCODE,
         &row->ACCESSTYPE
     };
+    memcpy(fields, f, sizeof(f));
+}
+
+/* Free memory allocated for a single row */
+void free_row(row_t *row) {
+    if (!row) return;                       // Do nothing for NULL row
+
+    char **fields[ROW_STR_FIELDS];
+    row_fields(row, fields);
 
-    int num_fields = sizeof(fields) / sizeof(fields[0]);
-    
     // Free all string fields
-    for (int j = 0; j < num_fields; j++) {
+    for (int j = 0; j < ROW_STR_FIELDS; j++) {
         free(*fields[j]);                   // Free each string field
     }
 
@@ -3,9 +3,10 @@
 #include <assert.h>
 #include "read.h"
 #include "search.h"
+#include "bit.h"
 
 /* Grow results array and add a new result */
-void push_result(search_stats_t *st, row_t *rec){
+void push_result(search_stats_t *st, row_id_t id){
     // Check if array needs resizing
     if (st->result_count == st->capacity) {
         // Double capacity or initialize to 2 if zero
@@ -15,40 +16,25 @@ void push_result(search_stats_t *st, row_t *rec){
         assert(st->results);  // Ensure allocation succeeded
     }
     // Add record to results array and increment count
-    st->results[st->result_count++] = rec;
+    st->results[st->result_count++] = id;
 }
 
-/* Custom string comparison that counts bits compared until first mismatch */
+/* Custom string comparison that counts bits compared until first mismatch.
+   Every matching byte (including a shared '\0') charges 8 bits; in the
+   differing byte each bit up to and including the first mismatch charges 1. */
 int strcmp_bits_firstdiff(const char *query, const char *cur, unsigned long long *bits){
-    size_t i = 0;
-    
-    // Compare bytes until difference found or strings end
-    for (;;) {
-        unsigned char queryChar = (unsigned char)query[i];
-        unsigned char curChar = (unsigned char)cur[i];
-        
-        if (queryChar == curChar) {
-            *bits += 8ULL;  // Add 8 bits for matching byte
-            if (queryChar == '\0') return 0;  // Strings are identical
-            i++;
-            continue;
-        }
-        
-        // Compare bits within the differing byte (from MSB to LSB)
-        for (int bit = 7; bit >= 0; --bit) {
-            (*bits)++;  // Count each bit comparison
-            int queryBit = (queryChar >> bit) & 1;  // Extract query bit
-            int curBit = (curChar >> bit) & 1;      // Extract current bit
-            
-            if (queryBit != curBit) {
-                // Return comparison result at first differing bit
-                return (queryChar < curChar) ? -1 : 1;
-            }
-        }
-        
-        // This point should never be reached (bytes must differ at some bit)
-        return (queryChar < curChar) ? -1 : 1;
+    size_t i = first_diff_byte(query, cur);  // Word-at-a-time scan
+    unsigned char queryChar = (unsigned char)query[i];
+    unsigned char curChar = (unsigned char)cur[i];
+
+    if (queryChar == curChar) {
+        *bits += 8ULL * (i + 1);            // Strings are identical
+        return 0;
     }
+
+    // Charge matched bytes plus bits up to the first differing bit (MSB first)
+    *bits += 8ULL * i + byte_diff_bit(queryChar, curChar) + 1;
+    return (queryChar < curChar) ? -1 : 1;
 }
 
 /* Search linked list for records matching EZI_ADD field */
@@ -60,6 +46,7 @@ void search_by_ezi_add(node_t *list, const char *query, search_stats_t *out){
     out->bit_comparisons = 0ULL;
     out->node_comparisons = 0U;
     out->string_comparisons = 0U;
+    out->distances = NULL;
     
     // Iterate through each node in linked list
     for (node_t *cur = list; cur; cur = cur->next) {
@@ -68,7 +55,7 @@ void search_by_ezi_add(node_t *list, const char *query, search_stats_t *out){
         
         // Compare query with EZI_ADD field, counting bits
         if (strcmp_bits_firstdiff(query, cur->data->EZI_ADD, &out->bit_comparisons) == 0) {
-            push_result(out, cur->data);  // Add matching record to results
+            push_result(out, cur->id);    // Add matching record to results
         }
     }
 }
\ No newline at end of file
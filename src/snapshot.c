@@ -0,0 +1,309 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+/*
+ * File layout (all offsets are from the start of the file, sections are
+ * 16-byte aligned, integers are native-endian):
+ *
+ *   snap_header_t
+ *   strings    NUL-terminated field values; offset 0 is ""
+ *   rows       snap_row_t[row_count], string fields as pool offsets
+ *   inner      pat_inner_t[inner_count]
+ *   leaves     pat_leaf_t[leaf_count]
+ *   leaf_rows  uint32_t[leaf_row_count], row ids in insertion order
+ *
+ * Nothing in the file is a pointer, so it can be mapped anywhere.
+ */
+
+#define SNAP_MAGIC    "DICTSNAP"
+#define SNAP_ENDIAN   0x01020304u
+#define SNAP_NULL     0xFFFFFFFFu   /* field was absent (NULL) */
+#define SNAP_ALIGN    16u
+
+typedef struct snap_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t ld_size;           /* sizeof(long double) on the writer */
+    uint32_t row_size;          /* sizeof(snap_row_t) on the writer */
+    uint32_t row_count;
+    uint32_t inner_count;
+    uint32_t leaf_count;
+    uint32_t leaf_row_count;
+    uint32_t root;
+    uint32_t reserved;
+    uint64_t strings_off, strings_len;
+    uint64_t rows_off, inner_off, leaves_off, leaf_rows_off;
+    uint64_t file_len;
+} snap_header_t;
+
+typedef struct snap_row {
+    uint32_t    field[ROW_STR_FIELDS];
+    long double x;
+    long double y;
+} snap_row_t;
+
+/* ---------- Writing ---------- */
+
+typedef struct string_pool {
+    char  *buf;
+    size_t len, cap;
+} string_pool_t;
+
+/* Append s to the pool and return its offset ("" shares offset 0) */
+static uint32_t pool_add(string_pool_t *p, const char *s) {
+    if (!s) return SNAP_NULL;
+    if (!*s) return 0;
+    size_t n = strlen(s) + 1;
+    if (p->len + n >= SNAP_NULL) return SNAP_NULL - 1;  /* caught by caller */
+    if (p->len + n > p->cap) {
+        size_t ncap = p->cap ? p->cap * 2 : 65536;
+        while (ncap < p->len + n) ncap *= 2;
+        char *tmp = realloc(p->buf, ncap);
+        if (!tmp) return SNAP_NULL - 1;
+        p->buf = tmp; p->cap = ncap;
+    }
+    memcpy(p->buf + p->len, s, n);
+    uint32_t off = (uint32_t)p->len;
+    p->len += n;
+    return off;
+}
+
+static uint64_t align_up(uint64_t v) {
+    return (v + SNAP_ALIGN - 1) & ~(uint64_t)(SNAP_ALIGN - 1);
+}
+
+/* Write len bytes then zero padding up to the next section boundary */
+static int write_section(FILE *fp, const void *data, size_t len, uint64_t *pos) {
+    static const char zeros[SNAP_ALIGN] = {0};
+    if (len && fwrite(data, 1, len, fp) != len) return -1;
+    uint64_t end = align_up(*pos + len);
+    size_t pad = (size_t)(end - (*pos + len));
+    if (pad && fwrite(zeros, 1, pad, fp) != pad) return -1;
+    *pos = end;
+    return 0;
+}
+
+int snapshot_write(const char *path, const row_t *rows, size_t count,
+                   const patricia_tree_t *tree) {
+    if (!path || !rows || !tree || count >= SNAP_NULL) return -1;
+
+    patricia_image_t img;
+    if (patricia_export_image(tree, &img) != 0) return -1;
+
+    string_pool_t pool = {0};
+    pool.cap = 65536;
+    pool.buf = calloc(1, pool.cap);         /* offset 0 is the empty string */
+    pool.len = 1;
+
+    snap_row_t *srows = calloc(count ? count : 1, sizeof(*srows));
+    int rc = (srows && pool.buf) ? 0 : -1;
+
+    // Encode rows: string fields become pool offsets
+    for (size_t i = 0; i < count && rc == 0; i++) {
+        char **fields[ROW_STR_FIELDS];
+        row_fields((row_t *)&rows[i], fields);
+        for (int j = 0; j < ROW_STR_FIELDS; j++) {
+            uint32_t off = pool_add(&pool, *fields[j]);
+            if (off == SNAP_NULL - 1) { rc = -1; break; }
+            srows[i].field[j] = off;
+        }
+        srows[i].x = rows[i].x;
+        srows[i].y = rows[i].y;
+    }
+
+    snap_header_t h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, sizeof(h.magic));
+    h.version        = SNAPSHOT_VERSION;
+    h.endian         = SNAP_ENDIAN;
+    h.ld_size        = (uint32_t)sizeof(long double);
+    h.row_size       = (uint32_t)sizeof(snap_row_t);
+    h.row_count      = (uint32_t)count;
+    h.inner_count    = img.inner_count;
+    h.leaf_count     = img.leaf_count;
+    h.leaf_row_count = img.leaf_row_count;
+    h.root           = img.root;
+    h.strings_off    = align_up(sizeof(h));
+    h.strings_len    = pool.len;
+    h.rows_off       = align_up(h.strings_off + h.strings_len);
+    h.inner_off      = align_up(h.rows_off + (uint64_t)count * sizeof(snap_row_t));
+    h.leaves_off     = align_up(h.inner_off + (uint64_t)img.inner_count * sizeof(pat_inner_t));
+    h.leaf_rows_off  = align_up(h.leaves_off + (uint64_t)img.leaf_count * sizeof(pat_leaf_t));
+    h.file_len       = align_up(h.leaf_rows_off + (uint64_t)img.leaf_row_count * sizeof(uint32_t));
+
+    FILE *fp = rc == 0 ? fopen(path, "wb") : NULL;
+    if (!fp) rc = -1;
+
+    uint64_t pos = 0;
+    if (rc == 0) rc = write_section(fp, &h, sizeof(h), &pos);
+    if (rc == 0) rc = write_section(fp, pool.buf, pool.len, &pos);
+    if (rc == 0) rc = write_section(fp, srows, count * sizeof(*srows), &pos);
+    if (rc == 0) rc = write_section(fp, img.inner, img.inner_count * sizeof(pat_inner_t), &pos);
+    if (rc == 0) rc = write_section(fp, img.leaves, img.leaf_count * sizeof(pat_leaf_t), &pos);
+    if (rc == 0) rc = write_section(fp, img.leaf_rows, img.leaf_row_count * sizeof(uint32_t), &pos);
+    if (fp && fclose(fp) != 0) rc = -1;
+
+    free(srows);
+    free(pool.buf);
+    patricia_free_image(&img);
+    return rc;
+}
+
+/* ---------- Loading ---------- */
+
+int snapshot_is_file(const char *path) {
+    char magic[sizeof(SNAP_MAGIC) - 1];
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    size_t got = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return got == sizeof(magic) && memcmp(magic, SNAP_MAGIC, sizeof(magic)) == 0;
+}
+
+/* Check that [off, off + n * size) lies inside the file */
+static int section_ok(const snap_header_t *h, uint64_t off, uint64_t n, uint64_t size) {
+    return off % SNAP_ALIGN == 0 && off <= h->file_len &&
+           (size == 0 || n <= (h->file_len - off) / size);
+}
+
+/* Check the mapped tree before it is searched: every leaf's row range and
+   row ids lie inside their arrays and its key (the EZI_ADD of its first
+   row) exists; from the root, every child reference is in range, each
+   node is reached once (no cycles or sharing), branch bits grow on the
+   way down, and each leaf's key is long enough for its parent's bit.
+   rows must already be resolved. */
+static int tree_ok(const patricia_image_t *img, const row_t *rows, uint32_t row_count) {
+    for (uint32_t i = 0; i < img->leaf_count; i++) {
+        const pat_leaf_t *l = &img->leaves[i];
+        if (l->first > img->leaf_row_count || l->count > img->leaf_row_count - l->first) return 0;
+        for (uint32_t k = 0; k < l->count; k++) {
+            if (img->leaf_rows[l->first + k] >= row_count) return 0;
+        }
+        if (l->count > 0 && !rows[img->leaf_rows[l->first]].EZI_ADD) return 0;
+    }
+    if (img->root == PAT_NIL) return 1;
+
+    // Depth-first walk with (reference, parent bit + 1) pairs
+    size_t nodes = (size_t)img->inner_count + img->leaf_count;
+    unsigned char *seen = calloc(nodes ? nodes : 1, 1);
+    uint32_t *stack = malloc((nodes + 1) * 2 * sizeof *stack);
+    if (!seen || !stack) { free(seen); free(stack); return 0; }
+    size_t top = 0;
+    int ok = 1;
+    stack[top++] = img->root;
+    stack[top++] = 0;
+    while (ok && top > 0) {
+        uint32_t above = stack[--top], ref = stack[--top];
+        if (ref & PAT_LEAF_TAG) {
+            uint32_t leaf = ref & ~PAT_LEAF_TAG;
+            ok = leaf < img->leaf_count && !seen[img->inner_count + (size_t)leaf] &&
+                 img->leaves[leaf].count > 0;
+            if (!ok) break;
+            seen[img->inner_count + (size_t)leaf] = 1;
+            const char *key = rows[img->leaf_rows[img->leaves[leaf].first]].EZI_ADD;
+            ok = above == 0 || strlen(key) >= (above - 1) / 8;
+            continue;
+        }
+        ok = ref < img->inner_count && !seen[ref] && img->inner[ref].bitIndex < UINT32_MAX &&
+             (above == 0 || img->inner[ref].bitIndex + 1 > above);
+        if (!ok) break;
+        seen[ref] = 1;
+        // each node is pushed once, so the stack never outgrows nodes + 1
+        for (int c = 0; c < 2; c++) {
+            stack[top++] = img->inner[ref].child[c];
+            stack[top++] = img->inner[ref].bitIndex + 1;
+        }
+    }
+    free(seen);
+    free(stack);
+    return ok;
+}
+
+int snapshot_load(const char *path, snapshot_t *snap) {
+    memset(snap, 0, sizeof(*snap));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(snap_header_t)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    snap->map = map;
+    snap->len = (size_t)sb.st_size;
+
+    // Validate header against this build before trusting any offsets
+    const snap_header_t *h = map;
+    if (memcmp(h->magic, SNAP_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != SNAPSHOT_VERSION || h->endian != SNAP_ENDIAN ||
+        h->ld_size != sizeof(long double) || h->row_size != sizeof(snap_row_t) ||
+        h->file_len != snap->len || h->strings_len == 0 ||
+        !section_ok(h, h->strings_off, h->strings_len, 1) ||
+        !section_ok(h, h->rows_off, h->row_count, sizeof(snap_row_t)) ||
+        !section_ok(h, h->inner_off, h->inner_count, sizeof(pat_inner_t)) ||
+        !section_ok(h, h->leaves_off, h->leaf_count, sizeof(pat_leaf_t)) ||
+        !section_ok(h, h->leaf_rows_off, h->leaf_row_count, sizeof(uint32_t))) {
+        snapshot_free(snap);
+        return -1;
+    }
+
+    const char *base = (const char *)map;
+    const char *strings = base + h->strings_off;
+    const snap_row_t *srows = (const snap_row_t *)(base + h->rows_off);
+    if (strings[h->strings_len - 1] != '\0') { snapshot_free(snap); return -1; }
+
+    // row_t holds native pointers, so resolve field offsets once
+    snap->count = h->row_count;
+    snap->rows  = malloc((h->row_count ? h->row_count : 1) * sizeof(*snap->rows));
+    snap->nodes = malloc((h->row_count ? h->row_count : 1) * sizeof(*snap->nodes));
+    if (!snap->rows || !snap->nodes) { snapshot_free(snap); return -1; }
+
+    for (uint32_t i = 0; i < h->row_count; i++) {
+        char **fields[ROW_STR_FIELDS];
+        row_fields(&snap->rows[i], fields);
+        for (int j = 0; j < ROW_STR_FIELDS; j++) {
+            uint32_t off = srows[i].field[j];
+            if (off != SNAP_NULL && off >= h->strings_len) { snapshot_free(snap); return -1; }
+            *fields[j] = (off == SNAP_NULL) ? NULL : (char *)(strings + off);
+        }
+        snap->rows[i].x = srows[i].x;
+        snap->rows[i].y = srows[i].y;
+        snap->nodes[i].data = &snap->rows[i];
+        snap->nodes[i].id = i;
+        snap->nodes[i].next = (i + 1 < h->row_count) ? &snap->nodes[i + 1] : NULL;
+    }
+
+    // The tree's nodes are searched straight from the mapping, once checked
+    patricia_image_t img;
+    img.inner          = (const pat_inner_t *)(base + h->inner_off);
+    img.leaves         = (const pat_leaf_t *)(base + h->leaves_off);
+    img.leaf_rows      = (const uint32_t *)(base + h->leaf_rows_off);
+    img.inner_count    = h->inner_count;
+    img.leaf_count     = h->leaf_count;
+    img.leaf_row_count = h->leaf_row_count;
+    img.root           = h->root;
+    if (!tree_ok(&img, snap->rows, h->row_count)) { snapshot_free(snap); return -1; }
+    snap->tree = patricia_from_image(&img, snap->rows);
+    return 0;
+}
+
+void snapshot_free(snapshot_t *snap) {
+    if (!snap) return;
+    free_patricia_tree(snap->tree);
+    free(snap->nodes);
+    free(snap->rows);
+    if (snap->map) munmap(snap->map, snap->len);
+    memset(snap, 0, sizeof(*snap));
+}
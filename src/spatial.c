@@ -0,0 +1,285 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spatial.h"
+
+/* Ranges this small are scanned instead of split further */
+#define KD_LEAF 8
+
+typedef struct kd_point {
+    double   x, y;
+    row_id_t id;
+} kd_point_t;
+
+struct kd_tree {
+    kd_point_t *pts;            /* implicit tree order */
+    size_t      count;
+};
+
+/* A scored point kept by nearest/radius queries */
+typedef struct kd_cand {
+    double   d2;                /* squared distance */
+    row_id_t id;
+} kd_cand_t;
+
+static double coord(const kd_point_t *p, int axis) {
+    return axis ? p->y : p->x;
+}
+
+/* Total order used for splitting: coordinate on axis, then row id */
+static int point_less(const kd_point_t *a, const kd_point_t *b, int axis) {
+    double ca = coord(a, axis), cb = coord(b, axis);
+    if (ca != cb) return ca < cb;
+    return a->id < b->id;
+}
+
+static void swap_points(kd_point_t *a, kd_point_t *b) {
+    kd_point_t tmp = *a; *a = *b; *b = tmp;
+}
+
+/* Partially sort p[lo..hi) so that p[nth] is in its sorted place, smaller
+   points before it and larger ones after (quickselect, median of three) */
+static void select_nth(kd_point_t *p, size_t lo, size_t hi, size_t nth, int axis) {
+    while (hi - lo > 2) {
+        size_t mid = lo + (hi - lo) / 2, last = hi - 1;
+        if (point_less(&p[mid], &p[lo], axis))  swap_points(&p[mid], &p[lo]);
+        if (point_less(&p[last], &p[lo], axis)) swap_points(&p[last], &p[lo]);
+        if (point_less(&p[last], &p[mid], axis)) swap_points(&p[last], &p[mid]);
+        swap_points(&p[mid], &p[last - 1]);            /* pivot at last - 1 */
+        kd_point_t *pivot = &p[last - 1];
+
+        size_t i = lo, j = last - 1;
+        for (;;) {
+            while (point_less(&p[++i], pivot, axis)) {}
+            while (point_less(pivot, &p[--j], axis)) {}
+            if (i >= j) break;
+            swap_points(&p[i], &p[j]);
+        }
+        swap_points(&p[i], &p[last - 1]);               /* pivot in place */
+
+        if (nth == i) return;
+        if (nth < i) hi = i;
+        else         lo = i + 1;
+    }
+    if (hi - lo == 2 && point_less(&p[lo + 1], &p[lo], axis))
+        swap_points(&p[lo], &p[lo + 1]);
+}
+
+static void build(kd_point_t *p, size_t lo, size_t hi, int axis) {
+    if (hi - lo <= KD_LEAF) return;
+    size_t mid = lo + (hi - lo) / 2;
+    select_nth(p, lo, hi, mid, axis);
+    build(p, lo, mid, !axis);
+    build(p, mid + 1, hi, !axis);
+}
+
+kd_tree_t *create_kd_tree(const double *xy, size_t count) {
+    kd_tree_t *t = calloc(1, sizeof *t);
+    if (!t) return NULL;
+    t->pts = malloc((count ? count : 1) * sizeof *t->pts);
+    if (!t->pts) { free(t); return NULL; }
+    t->count = count;
+    for (size_t i = 0; i < count; i++) {
+        t->pts[i].x  = xy[2 * i];
+        t->pts[i].y  = xy[2 * i + 1];
+        t->pts[i].id = (row_id_t)i;
+    }
+    build(t->pts, 0, count, 0);
+    return t;
+}
+
+void free_kd_tree(kd_tree_t *t) {
+    if (!t) return;
+    free(t->pts);
+    free(t);
+}
+
+/* ---------- Queries ---------- */
+
+static void stats_init(search_stats_t *out) {
+    out->results = NULL;
+    out->result_count = 0U;
+    out->capacity = 0U;
+    out->bit_comparisons = 0ULL;
+    out->node_comparisons = 0U;
+    out->string_comparisons = 0U;
+    out->distances = NULL;
+}
+
+static int cand_less(const kd_cand_t *a, const kd_cand_t *b) {
+    if (a->d2 != b->d2) return a->d2 < b->d2;
+    return a->id < b->id;
+}
+
+static int cand_cmp(const void *a, const void *b) {
+    const kd_cand_t *x = a, *y = b;
+    return cand_less(x, y) ? -1 : cand_less(y, x) ? 1 : 0;
+}
+
+static int id_cmp(const void *a, const void *b) {
+    row_id_t x = *(const row_id_t *)a, y = *(const row_id_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* State of a nearest-neighbour or radius query */
+typedef struct kd_query {
+    const kd_point_t *pts;
+    double            x, y;
+    double            r2;       /* radius query: squared radius */
+    unsigned          k;        /* nearest query: heap capacity, else 0 */
+    kd_cand_t        *cands;    /* max-heap (nearest) or list (radius) */
+    unsigned          size, cap;
+    search_stats_t   *st;
+} kd_query_t;
+
+static void heap_sift_down(kd_cand_t *h, unsigned n, unsigned i) {
+    for (;;) {
+        unsigned l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && cand_less(&h[m], &h[l])) m = l;
+        if (r < n && cand_less(&h[m], &h[r])) m = r;
+        if (m == i) return;
+        kd_cand_t tmp = h[i]; h[i] = h[m]; h[m] = tmp;
+        i = m;
+    }
+}
+
+static void heap_push(kd_cand_t *h, unsigned *n, kd_cand_t c) {
+    unsigned i = (*n)++;
+    h[i] = c;
+    while (i > 0 && cand_less(&h[(i - 1) / 2], &h[i])) {
+        kd_cand_t tmp = h[i]; h[i] = h[(i - 1) / 2]; h[(i - 1) / 2] = tmp;
+        i = (i - 1) / 2;
+    }
+}
+
+static void consider(kd_query_t *q, const kd_point_t *p) {
+    q->st->string_comparisons++;            /* point tested */
+    double dx = p->x - q->x, dy = p->y - q->y;
+    kd_cand_t c = { dx * dx + dy * dy, p->id };
+    if (q->k) {
+        if (q->size < q->k) {
+            heap_push(q->cands, &q->size, c);
+        } else if (cand_less(&c, &q->cands[0])) {
+            q->cands[0] = c;
+            heap_sift_down(q->cands, q->size, 0);
+        }
+        return;
+    }
+    if (c.d2 > q->r2) return;
+    if (q->size == q->cap) {
+        q->cap = q->cap ? q->cap * 2 : 16;
+        q->cands = realloc(q->cands, q->cap * sizeof *q->cands);
+        assert(q->cands);
+    }
+    q->cands[q->size++] = c;
+}
+
+/* Squared distance beyond which the other side of a split can be skipped */
+static double query_bound(const kd_query_t *q) {
+    if (!q->k) return q->r2;
+    return q->size < q->k ? -1.0 : q->cands[0].d2;
+}
+
+static void visit(kd_query_t *q, size_t lo, size_t hi, int axis) {
+    q->st->node_comparisons++;
+    if (hi - lo <= KD_LEAF) {
+        for (size_t i = lo; i < hi; i++) consider(q, &q->pts[i]);
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    consider(q, &q->pts[mid]);
+    double d = (axis ? q->y : q->x) - coord(&q->pts[mid], axis);
+    if (d < 0) visit(q, lo, mid, !axis);
+    else       visit(q, mid + 1, hi, !axis);
+    double bound = query_bound(q);
+    if (bound < 0 || d * d <= bound) {
+        if (d < 0) visit(q, mid + 1, hi, !axis);
+        else       visit(q, lo, mid, !axis);
+    }
+}
+
+/* Push the collected candidates nearest first */
+static void push_sorted(kd_query_t *q) {
+    if (q->size > 1) qsort(q->cands, q->size, sizeof *q->cands, cand_cmp);
+    for (unsigned i = 0; i < q->size; i++) push_result(q->st, q->cands[i].id);
+    free(q->cands);
+}
+
+void kd_nearest(const kd_tree_t *t, double x, double y, unsigned k,
+                search_stats_t *out) {
+    stats_init(out);
+    if (!t || t->count == 0 || k == 0) return;
+    if (k > t->count) k = (unsigned)t->count;
+    kd_query_t q = { t->pts, x, y, 0.0, k, NULL, 0, k, out };
+    q.cands = malloc(k * sizeof *q.cands);
+    assert(q.cands);
+    visit(&q, 0, t->count, 0);
+    push_sorted(&q);
+}
+
+void kd_radius(const kd_tree_t *t, double x, double y, double r,
+               search_stats_t *out) {
+    stats_init(out);
+    if (!t || t->count == 0 || !(r >= 0)) return;
+    kd_query_t q = { t->pts, x, y, r * r, 0, NULL, 0, 0, out };
+    visit(&q, 0, t->count, 0);
+    push_sorted(&q);
+}
+
+/* Box query state */
+typedef struct kd_box_query {
+    const kd_point_t *pts;
+    double            lo[2], hi[2];
+    search_stats_t   *st;
+} kd_box_query_t;
+
+static void box_test(kd_box_query_t *q, const kd_point_t *p) {
+    q->st->string_comparisons++;            /* point tested */
+    if (p->x >= q->lo[0] && p->x <= q->hi[0] &&
+        p->y >= q->lo[1] && p->y <= q->hi[1]) {
+        push_result(q->st, p->id);
+    }
+}
+
+static void box_visit(kd_box_query_t *q, size_t lo, size_t hi, int axis) {
+    q->st->node_comparisons++;
+    if (hi - lo <= KD_LEAF) {
+        for (size_t i = lo; i < hi; i++) box_test(q, &q->pts[i]);
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    double c = coord(&q->pts[mid], axis);
+    box_test(q, &q->pts[mid]);
+    if (q->lo[axis] <= c) box_visit(q, lo, mid, !axis);
+    if (q->hi[axis] >= c) box_visit(q, mid + 1, hi, !axis);
+}
+
+void kd_box(const kd_tree_t *t, double x0, double y0, double x1, double y1,
+            search_stats_t *out) {
+    stats_init(out);
+    if (!t || t->count == 0) return;
+    kd_box_query_t q = { t->pts, { x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1 },
+                         { x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0 }, out };
+    box_visit(&q, 0, t->count, 0);
+    if (out->result_count > 1)
+        qsort(out->results, out->result_count, sizeof *out->results, id_cmp);
+}
+
+void search_spatial(const kd_tree_t *t, const char *query, search_stats_t *out) {
+    double a, b, c, d;
+    unsigned k;
+    char extra;
+    if (sscanf(query, " near %lf %lf %u %c", &a, &b, &k, &extra) == 3) {
+        kd_nearest(t, a, b, k, out);
+    } else if (sscanf(query, " near %lf %lf %c", &a, &b, &extra) == 2) {
+        kd_nearest(t, a, b, 1U, out);
+    } else if (sscanf(query, " box %lf %lf %lf %lf %c", &a, &b, &c, &d, &extra) == 4) {
+        kd_box(t, a, b, c, d, out);
+    } else if (sscanf(query, " within %lf %lf %lf %c", &a, &b, &c, &extra) == 3) {
+        kd_radius(t, a, b, c, out);
+    } else {
+        stats_init(out);
+    }
+}
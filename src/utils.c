@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "bit.h"
 #include <stdio.h>
 #include <assert.h>
 #include <stdlib.h>
@@ -30,10 +31,6 @@ void strip_newline(char *str) {
     }
 }
 
-static inline int msb_bit(unsigned char byte, int bit_from_msb /*0..7*/) {
-    return (byte >> (7 - bit_from_msb)) & 1;
-}
-
 /* Returns first differing bit index (MSB-first within each byte).
    If strings are identical (including the NUL), returns UINT_MAX.
    If bit_count != NULL, it is incremented by the number of bits that
@@ -42,42 +39,21 @@ static inline int msb_bit(unsigned char byte, int bit_from_msb /*0..7*/) {
      - any bits in the NUL byte when strings are identical. */
 unsigned int first_diff_bit(const char *a, const char *b, unsigned long long *bit_count) {
     assert(a && b);
-    const unsigned char *pa = (const unsigned char *)a;
-    const unsigned char *pb = (const unsigned char *)b;
-
-    unsigned long long matched_bits = 0;
-    size_t i = 0;
+    size_t i = first_diff_byte(a, b);
+    unsigned char ab = (unsigned char)a[i];
+    unsigned char bb = (unsigned char)b[i];
 
-    for (;; ++i) {
-        unsigned char ab = pa[i];
-        unsigned char bb = pb[i];
-
-        if (ab == bb) {
-            if (ab == 0) {
-                /* Both NUL → identical. Do NOT charge the NUL byte's 8 bits. */
-                if (bit_count) *bit_count += matched_bits;
-                return UINT_MAX;
-            }
-            /* Bytes equal and non-zero → all 8 bits matched */
-            matched_bits += 8ULL;
-            continue;
-        }
-
-        /* Bytes differ: find first differing bit (MSB-first) */
-        for (int k = 0; k < 8; ++k) {
-            int abit = msb_bit(ab, k);
-            int bbit = msb_bit(bb, k);
-            if (abit != bbit) {
-                /* Charge only the bits that matched BEFORE this differing bit */
-                matched_bits += (unsigned long long)k;
-                if (bit_count) *bit_count += matched_bits;
-                /* Return global bit index (byte offset * 8 + bit offset from MSB) */
-                return (unsigned int)(i * 8U + k);
-            }
-        }
-
-        /* Should never reach here; we would have found a differing bit above. */
+    if (ab == bb) {
+        /* Both NUL → identical. Do NOT charge the NUL byte's 8 bits. */
+        if (bit_count) *bit_count += 8ULL * i;
+        return UINT_MAX;
     }
+
+    /* Charge only the bits that matched BEFORE the differing bit */
+    unsigned int k = byte_diff_bit(ab, bb);
+    if (bit_count) *bit_count += 8ULL * i + k;
+    /* Return global bit index (byte offset * 8 + bit offset from MSB) */
+    return (unsigned int)(i * 8U + k);
 }
 
 /* Returns min of 3 integers
@@ -0,0 +1,237 @@
+/*
+ * End-to-end benchmark of stage 1 (linked list) and stage 2 (Patricia
+ * tree) on synthetic datasets. For each size a CSV is generated, then
+ * load, build, and per-query latency for exact hits, near-misses (1-3
+ * edits, the fuzzy path) and misses are measured with a monotonic clock.
+ *
+ *   make bench [BENCH_ARGS="--rows=..."]    (builds and runs it)
+ *   ./bench_driver [--rows=1000,10000,100000] [--queries=1000] [--seed=1]
+ *           [--dir=bench_data] [--csv=bench_results.csv]
+ *           [--json=bench_results.json] [--summary=bench_summary.csv]
+ *
+ * The results file has one line per (rows, stage, query kind). The summary
+ * has the csv_size,linked_list,patricia_tree columns read by
+ * testing/cpu_time_vs_csv_size.py. Stage 1 scans every row per query, so
+ * on large files it only answers a sample of each kind (at least 10
+ * queries, about 2e7 rows scanned); its totals are scaled up from that.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "read.h"
+#include "search.h"
+#include "patricia.h"
+#include "synth.h"
+
+#define MAX_SIZES 16
+#define STAGE1_ROW_BUDGET 20000000.0
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Timings of one query kind on one stage */
+typedef struct kind_result {
+    size_t queries;
+    double seconds;             /* sum of per-query latencies */
+    double p50, p99, p999;      /* microseconds */
+    double mean_b, mean_n, mean_s;
+} kind_result_t;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted v[0..n) */
+static double percentile(const double *v, size_t n, double p) {
+    size_t rank = (size_t)(p * (double)n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return v[rank - 1];
+}
+
+typedef void (*bench_fn)(void *index, const char *q, search_stats_t *st);
+
+static void list_search(void *index, const char *q, search_stats_t *st) {
+    search_by_ezi_add((node_t *)index, q, st);
+}
+
+static void tree_search(void *index, const char *q, search_stats_t *st) {
+    search_patricia((patricia_tree_t *)index, q, st);
+}
+
+static kind_result_t run_kind(bench_fn fn, void *index, char **queries, size_t n) {
+    kind_result_t r;
+    memset(&r, 0, sizeof r);
+    double *lat = malloc((n ? n : 1) * sizeof *lat);
+    if (!lat) return r;
+    unsigned long long b = 0, nodes = 0, s = 0;
+    for (size_t i = 0; i < n; i++) {
+        search_stats_t st;
+        double t0 = now_sec();
+        fn(index, queries[i], &st);
+        lat[i] = now_sec() - t0;
+        r.seconds += lat[i];
+        b += st.bit_comparisons;
+        nodes += st.node_comparisons;
+        s += st.string_comparisons;
+        free(st.results);
+    }
+    qsort(lat, n, sizeof *lat, cmp_double);
+    r.queries = n;
+    if (n) {
+        r.p50  = percentile(lat, n, 0.50) * 1e6;
+        r.p99  = percentile(lat, n, 0.99) * 1e6;
+        r.p999 = percentile(lat, n, 0.999) * 1e6;
+        r.mean_b = (double)b / (double)n;
+        r.mean_n = (double)nodes / (double)n;
+        r.mean_s = (double)s / (double)n;
+    }
+    free(lat);
+    return r;
+}
+
+/* Parse "1000,10000,..." into sizes; returns how many */
+static int parse_sizes(const char *s, size_t sizes[MAX_SIZES]) {
+    int n = 0;
+    while (*s && n < MAX_SIZES) {
+        char *end;
+        double v = strtod(s, &end);     /* accepts 1e6 */
+        if (end == s || v < 1) return 0;
+        sizes[n++] = (size_t)v;
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return 0;
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    size_t sizes[MAX_SIZES] = { 1000, 10000, 100000 };
+    int nsizes = 3;
+    size_t per_kind = 1000;
+    uint64_t seed = 1;
+    const char *dir = "bench_data";
+    const char *csv_path = "bench_results.csv";
+    const char *json_path = "bench_results.json";
+    const char *summary_path = "bench_summary.csv";
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--rows=", 7) == 0) {
+            nsizes = parse_sizes(argv[i] + 7, sizes);
+        } else if (strncmp(argv[i], "--queries=", 10) == 0) {
+            per_kind = strtoull(argv[i] + 10, NULL, 10);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--dir=", 6) == 0) {
+            dir = argv[i] + 6;
+        } else if (strncmp(argv[i], "--csv=", 6) == 0) {
+            csv_path = argv[i] + 6;
+        } else if (strncmp(argv[i], "--json=", 7) == 0) {
+            json_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--summary=", 10) == 0) {
+            summary_path = argv[i] + 10;
+        } else {
+            nsizes = 0;
+            break;
+        }
+    }
+    if (nsizes == 0 || per_kind == 0) {
+        fprintf(stderr, "Usage: %s [--rows=N,N,...] [--queries=N] [--seed=S] [--dir=DIR]\n"
+                        "       [--csv=FILE] [--json=FILE] [--summary=FILE]\n", argv[0]);
+        return 1;
+    }
+    mkdir(dir, 0755);
+
+    FILE *fcsv = fopen(csv_path, "w");
+    FILE *fjson = fopen(json_path, "w");
+    FILE *fsum = fopen(summary_path, "w");
+    if (!fcsv || !fjson || !fsum) {
+        fprintf(stderr, "Error: could not open the output files\n");
+        return 1;
+    }
+    fprintf(fcsv, "rows,stage,load_s,build_s,kind,queries,seconds,qps,"
+                  "p50_us,p99_us,p999_us,mean_b,mean_n,mean_s\n");
+    fprintf(fjson, "[");
+    fprintf(fsum, "csv_size,linked_list,patricia_tree\n");
+    int first_json = 1;
+
+    for (int si = 0; si < nsizes; si++) {
+        size_t rows = sizes[si];
+        char path[4096];
+        snprintf(path, sizeof path, "%s/synth_%zu.csv", dir, rows);
+        if (synth_write_csv(path, rows, seed) != 0) {
+            fprintf(stderr, "Error: could not write %s\n", path);
+            return 1;
+        }
+
+        csv_arena_t arena;
+        double t0 = now_sec();
+        node_t *list = read_csv_arena(path, &arena);
+        double load_s = now_sec() - t0;
+        if (!list) {
+            fprintf(stderr, "Error: failed to read %s\n", path);
+            return 1;
+        }
+        const char **keys = malloc(arena.count * sizeof *keys);
+        for (size_t i = 0; i < arena.count; i++) keys[i] = arena.rows[i].EZI_ADD;
+
+        t0 = now_sec();
+        patricia_tree_t *tree = patricia_bulk_load(keys, arena.count);
+        double build_s = now_sec() - t0;
+
+        char **queries[SYNTH_KINDS];
+        for (int k = 0; k < SYNTH_KINDS; k++)
+            queries[k] = synth_queries(keys, arena.count, k, per_kind, seed);
+
+        double stage1_sample = STAGE1_ROW_BUDGET / (double)arena.count;
+        size_t n1 = stage1_sample < 10.0 ? 10 : (size_t)stage1_sample;
+        if (n1 > per_kind) n1 = per_kind;
+
+        double total[2] = { load_s, load_s + build_s };
+        for (int stage = 1; stage <= 2; stage++) {
+            for (int k = 0; k < SYNTH_KINDS; k++) {
+                kind_result_t r = stage == 1
+                    ? run_kind(list_search, list, queries[k], n1)
+                    : run_kind(tree_search, tree, queries[k], per_kind);
+                double qps = r.seconds > 0 ? (double)r.queries / r.seconds : 0.0;
+                double stage_build = stage == 1 ? 0.0 : build_s;
+                total[stage - 1] += r.queries ? r.seconds * (double)per_kind / (double)r.queries : 0.0;
+
+                fprintf(fcsv, "%zu,%d,%.6f,%.6f,%s,%zu,%.6f,%.1f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f\n",
+                        arena.count, stage, load_s, stage_build, synth_kind_name[k], r.queries,
+                        r.seconds, qps, r.p50, r.p99, r.p999, r.mean_b, r.mean_n, r.mean_s);
+                fprintf(fjson, "%s\n  {\"rows\": %zu, \"stage\": %d, \"load_s\": %.6f, "
+                               "\"build_s\": %.6f, \"kind\": \"%s\", \"queries\": %zu, "
+                               "\"seconds\": %.6f, \"qps\": %.1f, \"p50_us\": %.3f, "
+                               "\"p99_us\": %.3f, \"p999_us\": %.3f, \"mean_b\": %.1f, "
+                               "\"mean_n\": %.1f, \"mean_s\": %.1f}",
+                        first_json ? "" : ",", arena.count, stage, load_s, stage_build,
+                        synth_kind_name[k], r.queries, r.seconds, qps, r.p50, r.p99,
+                        r.p999, r.mean_b, r.mean_n, r.mean_s);
+                first_json = 0;
+                printf("rows %-9zu stage %d %-4s %6zu queries %12.1f q/s  p50 %9.2f us  "
+                       "p99 %9.2f us  p999 %9.2f us\n", arena.count, stage,
+                       synth_kind_name[k], r.queries, qps, r.p50, r.p99, r.p999);
+            }
+        }
+        printf("rows %-9zu load %.3f s  build %.3f s\n", arena.count, load_s, build_s);
+        fprintf(fsum, "%zu,%.6f,%.6f\n", arena.count, total[0], total[1]);
+
+        for (int k = 0; k < SYNTH_KINDS; k++) synth_free_queries(queries[k], per_kind);
+        free(keys);
+        free_patricia_tree(tree);
+        free_csv_arena(&arena);
+    }
+    fprintf(fjson, "\n]\n");
+    fclose(fcsv);
+    fclose(fjson);
+    fclose(fsum);
+    return 0;
+}
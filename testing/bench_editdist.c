@@ -0,0 +1,85 @@
+/*
+ * Microbenchmark: all-pairs edit distance over the EZI_ADD keys of a CSV,
+ * comparing the O(n*m) editDistance table with the Myers kernels.
+ *
+ *   make bench_editdist
+ *   ./bench_editdist tests/dataset_1067.csv
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "read.h"
+#include "utils.h"
+#include "editdist.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv = argc > 1 ? argv[1] : "tests/dataset_1067.csv";
+    csv_arena_t arena;
+    if (!read_csv_arena(csv, &arena)) {
+        fprintf(stderr, "Error: failed to read %s\n", csv);
+        return 1;
+    }
+
+    size_t n = arena.count;
+    const char **keys = malloc(n * sizeof *keys);
+    int *lens = malloc(n * sizeof *lens);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = arena.rows[i].EZI_ADD ? arena.rows[i].EZI_ADD : "";
+        lens[i] = (int)strlen(keys[i]);
+    }
+
+    // Reference: the DP table used before the Myers engine
+    long long sum_dp = 0;
+    double t0 = now_sec();
+    for (size_t q = 0; q < n; q++)
+        for (size_t i = 0; i < n; i++)
+            sum_dp += editDistance((char *)keys[q], (char *)keys[i], lens[q], lens[i]);
+    double t_dp = now_sec() - t0;
+
+    // Myers, one candidate at a time
+    long long sum_myers = 0;
+    t0 = now_sec();
+    for (size_t q = 0; q < n; q++) {
+        ed_pattern_t p;
+        ed_pattern_init(&p, keys[q], lens[q]);
+        for (size_t i = 0; i < n; i++) sum_myers += ed_distance(&p, keys[i], lens[i]);
+        ed_pattern_free(&p);
+    }
+    double t_myers = now_sec() - t0;
+
+    // Myers, ED_BATCH candidates per call (SIMD lanes)
+    long long sum_batch = 0;
+    t0 = now_sec();
+    for (size_t q = 0; q < n; q++) {
+        ed_pattern_t p;
+        ed_pattern_init(&p, keys[q], lens[q]);
+        for (size_t i = 0; i < n; i += ED_BATCH) {
+            int k = (int)(n - i < ED_BATCH ? n - i : ED_BATCH), d[ED_BATCH];
+            ed_distance_batch(&p, keys + i, lens + i, k, d);
+            for (int j = 0; j < k; j++) sum_batch += d[j];
+        }
+        ed_pattern_free(&p);
+    }
+    double t_batch = now_sec() - t0;
+
+    double pairs = (double)n * (double)n;
+    printf("keys,%zu\n", n);
+    printf("kernel,seconds,ns_per_pair,checksum\n");
+    printf("editDistance,%.6f,%.1f,%lld\n", t_dp, t_dp * 1e9 / pairs, sum_dp);
+    printf("myers,%.6f,%.1f,%lld\n", t_myers, t_myers * 1e9 / pairs, sum_myers);
+    printf("myers_batch,%.6f,%.1f,%lld\n", t_batch, t_batch * 1e9 / pairs, sum_batch);
+
+    free(lens);
+    free(keys);
+    free_csv_arena(&arena);
+    return (sum_dp == sum_myers && sum_dp == sum_batch) ? 0 : 1;
+}
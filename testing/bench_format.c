@@ -0,0 +1,154 @@
+/*
+ * Microbenchmark: formatting the answers of a query workload, comparing
+ * the original fprintf-per-field printer with the buffered formatter used
+ * by the executor. The answers are computed once up front; only output is
+ * timed, written to /dev/null. Both outputs are also rendered to memory
+ * and must be byte-identical.
+ *
+ *   make bench_format
+ *   ./bench_format tests/dataset_1067.csv tests/test1067.in [rounds]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "read.h"
+#include "patricia.h"
+#include "exec.h"
+#include "utils.h"
+
+#define SAFE_STR(s) ((s) ? (s) : "")
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Reference: the printer used before the buffered formatter
+static const char *HEADERS[35] = {
+  "PFI","EZI_ADD","SRC_VERIF","PROPSTATUS","GCODEFEAT","LOC_DESC",
+  "BLGUNTTYP","HSAUNITID","BUNIT_PRE1","BUNIT_ID1","BUNIT_SUF1",
+  "BUNIT_PRE2","BUNIT_ID2","BUNIT_SUF2","FLOOR_TYPE","FLOOR_NO_1",
+  "FLOOR_NO_2","BUILDING","COMPLEX","HSE_PREF1","HSE_NUM1","HSE_SUF1",
+  "HSE_PREF2","HSE_NUM2","HSE_SUF2","DISP_NUM1","ROAD_NAME","ROAD_TYPE",
+  "RD_SUF","LOCALITY","STATE","POSTCODE","ACCESSTYPE","x","y"
+};
+
+static void legacy_print_record(FILE *out, const row_t *a) {
+    char **fields[ROW_STR_FIELDS];
+    row_fields((row_t *)a, fields);
+    fprintf(out, "--> ");
+    for (int i = 0; i < ROW_STR_FIELDS; i++)
+        fprintf(out, "%s: %s || ", HEADERS[i], SAFE_STR(*fields[i]));
+    fprintf(out, "%s: %Lf || ", HEADERS[33], a->x);
+    fprintf(out, "%s: %Lf\n",   HEADERS[34], a->y);
+}
+
+static void legacy_write(FILE *fout, FILE *summary, const row_t *rows,
+                         const char *q, const search_stats_t *st) {
+    fprintf(fout, "%s\n", q);
+    if (st->result_count == 0) {
+        fprintf(fout, "NOTFOUND\n");
+    } else {
+        for (unsigned int i = 0; i < st->result_count; i++)
+            legacy_print_record(fout, &rows[st->results[i]]);
+    }
+    fprintf(summary, "%s --> %u records found - comparisons: b%llu n%u s%u\n",
+            q, st->result_count, (unsigned long long)st->bit_comparisons,
+            st->node_comparisons, st->string_comparisons);
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv = argc > 1 ? argv[1] : "tests/dataset_1067.csv";
+    const char *qfile = argc > 2 ? argv[2] : "tests/test1067.in";
+    int rounds = argc > 3 ? atoi(argv[3]) : 50;
+    if (rounds < 1) rounds = 1;
+
+    csv_arena_t arena;
+    FILE *qin = fopen(qfile, "r");
+    if (!read_csv_arena(csv, &arena) || !qin) {
+        fprintf(stderr, "Error: failed to read %s / %s\n", csv, qfile);
+        return 1;
+    }
+    patricia_tree_t *tree = create_patricia_tree();
+    for (size_t i = 0; i < arena.count; i++)
+        if (arena.rows[i].EZI_ADD)
+            insert_into_patricia(tree, arena.rows[i].EZI_ADD, (row_id_t)i);
+
+    // Answer every query once
+    size_t n = 0, cap = 256;
+    char (*queries)[1024] = malloc(cap * sizeof *queries);
+    search_stats_t *st = malloc(cap * sizeof *st);
+    while (fgets(queries[n], sizeof queries[n], qin)) {
+        strip_newline(queries[n]);
+        search_patricia(tree, queries[n], &st[n]);
+        if (++n == cap) {
+            cap *= 2;
+            queries = realloc(queries, cap * sizeof *queries);
+            st = realloc(st, cap * sizeof *st);
+        }
+    }
+    fclose(qin);
+    unsigned long long records = 0;
+    for (size_t i = 0; i < n; i++) records += st[i].result_count;
+    row_source_t src = { arena.rows, NULL };
+
+    // Byte-identical check
+    char *ref_out = NULL, *ref_sum = NULL;
+    size_t ref_out_len, ref_sum_len;
+    FILE *mo = open_memstream(&ref_out, &ref_out_len);
+    FILE *ms = open_memstream(&ref_sum, &ref_sum_len);
+    for (size_t i = 0; i < n; i++) legacy_write(mo, ms, arena.rows, queries[i], &st[i]);
+    fclose(mo);
+    fclose(ms);
+    out_buf_t bo, bs;
+    out_init(&bo, -1, NULL);
+    out_init(&bs, -1, NULL);
+    for (size_t i = 0; i < n; i++) write_query_result(&bo, &bs, &src, queries[i], &st[i]);
+    int same = bo.len == ref_out_len && memcmp(bo.data, ref_out, bo.len) == 0 &&
+               bs.len == ref_sum_len && memcmp(bs.data, ref_sum, bs.len) == 0;
+    free(bo.data); free(bs.data); free(ref_out); free(ref_sum);
+
+    // Legacy printer through stdio
+    FILE *devnull = fopen("/dev/null", "w");
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; r++)
+        for (size_t i = 0; i < n; i++) legacy_write(devnull, devnull, arena.rows, queries[i], &st[i]);
+    fflush(devnull);
+    double t_legacy = now_sec() - t0;
+
+    // Buffered formatter, flushed with write(2)
+    int fd = fileno(devnull);
+    t0 = now_sec();
+    out_init(&bo, fd, NULL);
+    out_init(&bs, fd, NULL);
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            write_query_result(&bo, &bs, &src, queries[i], &st[i]);
+            out_maybe_flush(&bo);
+            out_maybe_flush(&bs);
+        }
+    }
+    out_free(&bo);
+    out_free(&bs);
+    double t_buffered = now_sec() - t0;
+    fclose(devnull);
+
+    double total = (double)records * rounds;
+    printf("queries,%zu\nrecords,%llu\nidentical,%s\n", n, records, same ? "yes" : "NO");
+    printf("printer,seconds,ns_per_record\n");
+    printf("fprintf,%.6f,%.1f\n", t_legacy, t_legacy * 1e9 / total);
+    printf("buffered,%.6f,%.1f\n", t_buffered, t_buffered * 1e9 / total);
+
+    for (size_t i = 0; i < n; i++) free(st[i].results);
+    free(st);
+    free(queries);
+    free_patricia_tree(tree);
+    free_csv_arena(&arena);
+    return same ? 0 : 1;
+}
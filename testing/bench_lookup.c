@@ -0,0 +1,114 @@
+/*
+ * Microbenchmark: exact-match lookups of every EZI_ADD key of a CSV,
+ * one search_patricia call per key versus search_patricia_batch, with the
+ * stage 3 hash index as a baseline.
+ *
+ *   make bench_lookup
+ *   ./bench_lookup tests/dataset_1067.csv [rounds]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "read.h"
+#include "patricia.h"
+#include "hashindex.h"
+
+#define BENCH_BATCH 256
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv = argc > 1 ? argv[1] : "tests/dataset_1067.csv";
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    if (rounds < 1) rounds = 1;
+
+    csv_arena_t arena;
+    if (!read_csv_arena(csv, &arena)) {
+        fprintf(stderr, "Error: failed to read %s\n", csv);
+        return 1;
+    }
+
+    patricia_tree_t *tree = create_patricia_tree();
+    size_t n = 0;
+    const char **keys = malloc(arena.count * sizeof *keys);
+    const char **row_keys = malloc(arena.count * sizeof *row_keys);
+    for (size_t i = 0; i < arena.count; i++) {
+        row_keys[i] = arena.rows[i].EZI_ADD;
+        if (!arena.rows[i].EZI_ADD) continue;
+        insert_into_patricia(tree, arena.rows[i].EZI_ADD, (row_id_t)i);
+        keys[n++] = arena.rows[i].EZI_ADD;
+    }
+
+    // Shuffle so consecutive queries do not walk neighbouring nodes
+    srand(1);
+    for (size_t i = n; i > 1; i--) {
+        size_t j = (size_t)rand() % i;
+        const char *tmp = keys[i - 1]; keys[i - 1] = keys[j]; keys[j] = tmp;
+    }
+
+    // One query at a time
+    unsigned long long sum_single = 0;
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            search_stats_t st;
+            search_patricia(tree, keys[i], &st);
+            sum_single += st.bit_comparisons + st.node_comparisons
+                        + st.string_comparisons + st.result_count;
+            free(st.results);
+        }
+    }
+    double t_single = now_sec() - t0;
+
+    // Interleaved batches
+    unsigned long long sum_batch = 0;
+    search_stats_t st[BENCH_BATCH];
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i += BENCH_BATCH) {
+            size_t k = n - i < BENCH_BATCH ? n - i : BENCH_BATCH;
+            search_patricia_batch(tree, keys + i, k, st);
+            for (size_t j = 0; j < k; j++) {
+                sum_batch += st[j].bit_comparisons + st[j].node_comparisons
+                           + st[j].string_comparisons + st[j].result_count;
+                free(st[j].results);
+            }
+        }
+    }
+    double t_batch = now_sec() - t0;
+
+    // Hash index (b/n/s differ from the tree, so only results are summed)
+    hash_index_t *h = create_hash_index(row_keys, arena.count);
+    unsigned long long rows_hash = 0;
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            search_stats_t hs;
+            search_hash_index(h, keys[i], &hs);
+            rows_hash += hs.result_count;
+            free(hs.results);
+        }
+    }
+    double t_hash = now_sec() - t0;
+    free_hash_index(h);
+
+    double lookups = (double)n * rounds;
+    printf("keys,%zu\n", n);
+    printf("method,seconds,ns_per_lookup,checksum\n");
+    printf("single,%.6f,%.1f,%llu\n", t_single, t_single * 1e9 / lookups, sum_single);
+    printf("batch,%.6f,%.1f,%llu\n", t_batch, t_batch * 1e9 / lookups, sum_batch);
+    printf("hash,%.6f,%.1f,%llu\n", t_hash, t_hash * 1e9 / lookups, rows_hash);
+
+    free(row_keys);
+    free(keys);
+    free_patricia_tree(tree);
+    free_csv_arena(&arena);
+    return sum_single == sum_batch ? 0 : 1;
+}
@@ -1,3 +1,4 @@
+import sys
 import pandas as pd
 import matplotlib.pyplot as plt
 
@@ -8,7 +9,8 @@ data = {
     "patricia_tree": [0.003, 0.007, 0.017, 0.027]  # stripped 's' to store as float
 }
 
-df = pd.DataFrame(data)
+# Or read them from ./bench's summary file: python3 cpu_time_vs_csv_size.py bench_summary.csv
+df = pd.read_csv(sys.argv[1]) if len(sys.argv) > 1 else pd.DataFrame(data)
 
 # Plot
 plt.figure(figsize=(8, 5))
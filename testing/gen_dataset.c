@@ -0,0 +1,67 @@
+/*
+ * Synthetic dataset generator: writes an address CSV of ROWS records and,
+ * optionally, a query file of QUERIES lines per class (exact hits,
+ * near-misses with 1-3 edits, misses), shuffled together.
+ *
+ *   make gen_dataset
+ *   ./gen_dataset 1000000 big.csv big.in [QUERIES] [SEED]
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "read.h"
+#include "synth.h"
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <rows> <out.csv> [<queries.in> [queries per class] [seed]]\n",
+                argv[0]);
+        return 1;
+    }
+    size_t rows = strtoull(argv[1], NULL, 10);
+    size_t per_kind = argc > 4 ? strtoull(argv[4], NULL, 10) : 1000;
+    uint64_t seed = argc > 5 ? strtoull(argv[5], NULL, 10) : 1;
+
+    if (synth_write_csv(argv[2], rows, seed) != 0) {
+        fprintf(stderr, "Error: could not write %s\n", argv[2]);
+        return 1;
+    }
+    if (argc < 4) return 0;
+
+    // Queries are drawn from the keys of the file just written
+    csv_arena_t arena;
+    if (!read_csv_arena(argv[2], &arena)) {
+        fprintf(stderr, "Error: failed to read back %s\n", argv[2]);
+        return 1;
+    }
+    const char **keys = malloc((arena.count ? arena.count : 1) * sizeof *keys);
+    for (size_t i = 0; i < arena.count; i++) keys[i] = arena.rows[i].EZI_ADD;
+
+    size_t total = per_kind * SYNTH_KINDS;
+    char **all = malloc((total ? total : 1) * sizeof *all);
+    for (int k = 0; k < SYNTH_KINDS; k++) {
+        char **q = synth_queries(keys, arena.count, k, per_kind, seed);
+        if (!q) { fprintf(stderr, "Error: out of memory\n"); return 1; }
+        for (size_t i = 0; i < per_kind; i++) all[k * per_kind + i] = q[i];
+        free(q);
+    }
+    srand((unsigned)seed);
+    for (size_t i = total; i > 1; i--) {
+        size_t j = (size_t)rand() % i;
+        char *tmp = all[i - 1]; all[i - 1] = all[j]; all[j] = tmp;
+    }
+
+    FILE *fp = fopen(argv[3], "w");
+    if (!fp) {
+        fprintf(stderr, "Error: could not write %s\n", argv[3]);
+        return 1;
+    }
+    for (size_t i = 0; i < total; i++) fprintf(fp, "%s\n", all[i]);
+    fclose(fp);
+
+    synth_free_queries(all, total);
+    free(keys);
+    free_csv_arena(&arena);
+    return 0;
+}
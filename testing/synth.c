@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synth.h"
+
+const char *const synth_kind_name[SYNTH_KINDS] = { "hit", "near", "miss" };
+
+static const char *const ROAD_PRE[] = {
+    "", "", "", "", "OLD ", "NORTH ", "SOUTH ", "EAST ", "WEST ", "UPPER ", "LOWER ", "LITTLE "
+};
+static const char *const ROAD[] = {
+    "BERKELEY", "PROFESSORS", "SWANSTON", "LYGON", "ROYAL", "GRATTAN", "ELGIN",
+    "FARADAY", "CARDIGAN", "QUEENSBERRY", "VICTORIA", "PELHAM", "BARRY",
+    "LINCOLN", "DRUMMOND", "RATHDOWNE", "NICHOLSON", "LEICESTER", "ABBOTSFORD",
+    "FLEMINGTON", "MACARTHUR", "BOUVERIE", "STORY", "TIN ALLEY", "MONASH",
+    "COLLINS", "BOURKE", "LONSDALE", "FLINDERS", "EXHIBITION", "SPRING",
+    "ELIZABETH", "WILLIAM", "QUEEN", "KING", "SPENCER", "LA TROBE", "RUSSELL",
+    "HARDWARE", "DEGRAVES", "HOSIER", "CHAPEL", "HIGH", "CHURCH", "BRUNSWICK",
+    "SYDNEY", "HODDLE", "PUNT", "ALEXANDRA", "JOHNSTON", "GERTRUDE", "SMITH",
+    "WELLINGTON", "NAPIER", "YOUNG", "FITZROY", "GORE", "KERR", "ARGYLE", "BRIDGE"
+};
+static const char *const ROAD_TYPE[] = {
+    "STREET", "STREET", "STREET", "ROAD", "ROAD", "AVENUE", "LANE", "PLACE",
+    "PARADE", "WALK", "CRESCENT", "COURT", "TERRACE", "GROVE", "DRIVE", "CLOSE"
+};
+static const struct locality {
+    const char *name;
+    int         postcode;
+    double      x, y;
+} LOCALITY[] = {
+    { "MELBOURNE", 3000, 144.9631, -37.8136 }, { "CARLTON", 3053, 144.9668, -37.8001 },
+    { "PARKVILLE", 3052, 144.9510, -37.7870 }, { "NORTH MELBOURNE", 3051, 144.9446, -37.7990 },
+    { "FITZROY", 3065, 144.9780, -37.7990 },   { "COLLINGWOOD", 3066, 144.9880, -37.8020 },
+    { "RICHMOND", 3121, 144.9980, -37.8180 },  { "SOUTHBANK", 3006, 144.9640, -37.8230 },
+    { "DOCKLANDS", 3008, 144.9460, -37.8170 }, { "EAST MELBOURNE", 3002, 144.9850, -37.8130 },
+    { "WEST MELBOURNE", 3003, 144.9420, -37.8070 }, { "KENSINGTON", 3031, 144.9300, -37.7940 },
+    { "FLEMINGTON", 3031, 144.9290, -37.7870 }, { "BRUNSWICK", 3056, 144.9600, -37.7670 },
+    { "NORTHCOTE", 3070, 145.0000, -37.7700 }, { "ABBOTSFORD", 3067, 144.9990, -37.8040 },
+    { "SOUTH YARRA", 3141, 144.9920, -37.8380 }, { "PRAHRAN", 3181, 144.9910, -37.8510 },
+    { "ST KILDA", 3182, 144.9810, -37.8640 },  { "PORT MELBOURNE", 3207, 144.9420, -37.8390 },
+    { "SOUTH MELBOURNE", 3205, 144.9580, -37.8330 }, { "ALBERT PARK", 3206, 144.9550, -37.8450 },
+    { "CARLTON NORTH", 3054, 144.9700, -37.7850 }, { "FITZROY NORTH", 3068, 144.9850, -37.7840 },
+    { "CLIFTON HILL", 3068, 144.9950, -37.7890 }, { "COBURG", 3058, 144.9640, -37.7440 },
+    { "ESSENDON", 3040, 144.9190, -37.7540 },  { "ASCOT VALE", 3032, 144.9220, -37.7750 },
+    { "FOOTSCRAY", 3011, 144.8990, -37.8000 }, { "YARRAVILLE", 3013, 144.8900, -37.8160 },
+    { "HAWTHORN", 3122, 145.0310, -37.8220 },  { "KEW", 3101, 145.0350, -37.8060 }
+};
+static const char *const UNIT_SUF[] = { "", "", "", "", "A", "B", "S", "G" };
+static const char *const VERIF[] = {
+    "2009-01-15", "2012-06-30", "2017-04-12", "2019-08-01", "2021-12-03", "2024-12-17"
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/* xorshift64* */
+static uint64_t next_rand(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 2685821657736338717ULL;
+}
+
+static size_t pick(uint64_t *s, size_t n) {
+    return (size_t)(next_rand(s) % n);
+}
+
+static double unit_real(uint64_t *s) {
+    return (double)(next_rand(s) >> 11) / 9007199254740992.0;
+}
+
+/* One address: the EZI_ADD, plus the parts the other columns repeat */
+typedef struct address {
+    char        key[160];
+    char        unit[16];       /* unit id without suffix, "" if none */
+    const char *unit_suf;
+    int         number;
+    char        road[48];
+    const char *type;
+    const struct locality *loc;
+} address_t;
+
+static void make_address(address_t *a, uint64_t *s, int number) {
+    a->unit[0] = '\0';
+    a->unit_suf = "";
+    if (pick(s, 10) < 3) {
+        snprintf(a->unit, sizeof a->unit, "%d", 1 + (int)pick(s, 60));
+        a->unit_suf = UNIT_SUF[pick(s, COUNT(UNIT_SUF))];
+    }
+    a->number = number;
+    snprintf(a->road, sizeof a->road, "%s%s", ROAD_PRE[pick(s, COUNT(ROAD_PRE))],
+             ROAD[pick(s, COUNT(ROAD))]);
+    a->type = ROAD_TYPE[pick(s, COUNT(ROAD_TYPE))];
+    a->loc = &LOCALITY[pick(s, COUNT(LOCALITY))];
+    if (a->unit[0]) {
+        snprintf(a->key, sizeof a->key, "%s%s/%d %s %s %s %d", a->unit, a->unit_suf,
+                 a->number, a->road, a->type, a->loc->name, a->loc->postcode);
+    } else {
+        snprintf(a->key, sizeof a->key, "%d %s %s %s %d", a->number, a->road,
+                 a->type, a->loc->name, a->loc->postcode);
+    }
+}
+
+static void write_row(FILE *fp, uint64_t *s, const address_t *a, unsigned long long pfi) {
+    double x = a->loc->x + (unit_real(s) - 0.5) * 0.02;
+    double y = a->loc->y + (unit_real(s) - 0.5) * 0.02;
+    fprintf(fp, "%llu,%s,%s,A,V,,%s,,,%s%s,%s,,,,,,,,,,%d.0,,,,,,%s,%s,,%s,VIC,%d,L,%.14f,%.14f\n",
+            pfi, a->key, VERIF[pick(s, COUNT(VERIF))], a->unit[0] ? "UNIT" : "",
+            a->unit, a->unit[0] ? ".0" : "", a->unit_suf, a->number, a->road, a->type,
+            a->loc->name, a->loc->postcode, x, y);
+}
+
+int synth_write_csv(const char *path, size_t rows, uint64_t seed) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    uint64_t s = seed * 0x9E3779B97F4A7C15ULL + 1;
+    fputs("PFI,EZI_ADD,SRC_VERIF,PROPSTATUS,GCODEFEAT,LOC_DESC,BLGUNTTYP,HSAUNITID,"
+          "BUNIT_PRE1,BUNIT_ID1,BUNIT_SUF1,BUNIT_PRE2,BUNIT_ID2,BUNIT_SUF2,FLOOR_TYPE,"
+          "FLOOR_NO_1,FLOOR_NO_2,BUILDING,COMPLEX,HSE_PREF1,HSE_NUM1,HSE_SUF1,HSE_PREF2,"
+          "HSE_NUM2,HSE_SUF2,DISP_NUM1,ROAD_NAME,ROAD_TYPE,RD_SUF,LOCALITY,STATE,POSTCODE,"
+          "ACCESSTYPE,x,y\n", fp);
+    address_t a;
+    size_t i = 0;
+    while (i < rows) {
+        make_address(&a, &s, 1 + (int)pick(&s, 999));
+        /* about one key in ten has 2-4 rows (e.g. parts of one property) */
+        size_t copies = pick(&s, 10) == 0 ? 2 + pick(&s, 3) : 1;
+        for (size_t c = 0; c < copies && i < rows; c++, i++)
+            write_row(fp, &s, &a, 400000000ULL + i);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+static char *dup_str(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *p = malloc(n);
+    if (p) memcpy(p, s, n);
+    return p;
+}
+
+/* Apply one random substitution, insertion or deletion to buf */
+static void random_edit(char *buf, size_t cap, uint64_t *s) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+    size_t len = strlen(buf);
+    int op = len ? (int)pick(s, 3) : 1;
+    char c = alphabet[pick(s, sizeof alphabet - 1)];
+    if (op == 0) {                              /* substitute */
+        size_t i = pick(s, len);
+        buf[i] = buf[i] == c ? (c == 'A' ? 'B' : 'A') : c;
+    } else if (op == 1 && len + 1 < cap) {      /* insert */
+        size_t i = pick(s, len + 1);
+        memmove(buf + i + 1, buf + i, len - i + 1);
+        buf[i] = c;
+    } else if (len) {                           /* delete */
+        size_t i = pick(s, len);
+        memmove(buf + i, buf + i + 1, len - i);
+    }
+}
+
+char **synth_queries(const char *const keys[], size_t nkeys, int kind,
+                     size_t count, uint64_t seed) {
+    char **q = calloc(count ? count : 1, sizeof *q);
+    if (!q) return NULL;
+    uint64_t s = seed * 0x9E3779B97F4A7C15ULL + 7 + (uint64_t)kind;
+    char buf[256];
+    for (size_t i = 0; i < count; i++) {
+        const char *key = NULL;
+        for (int tries = 0; nkeys && !key && tries < 64; tries++) key = keys[pick(&s, nkeys)];
+        if (kind == SYNTH_MISS || !key) {
+            address_t a;
+            make_address(&a, &s, 1000 + (int)pick(&s, 9000));
+            snprintf(buf, sizeof buf, "%s", a.key);
+        } else {
+            snprintf(buf, sizeof buf, "%s", key);
+            if (kind == SYNTH_NEAR) {
+                int edits = 1 + (int)pick(&s, 3);
+                for (int e = 0; e < edits; e++) random_edit(buf, sizeof buf, &s);
+            }
+        }
+        q[i] = dup_str(buf);
+        if (!q[i]) { synth_free_queries(q, i); return NULL; }
+    }
+    return q;
+}
+
+void synth_free_queries(char **queries, size_t count) {
+    if (!queries) return;
+    for (size_t i = 0; i < count; i++) free(queries[i]);
+    free(queries);
+}
@@ -0,0 +1,35 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Synthetic address data for benchmarks: dataset CSVs in the real column
+   layout, and query sets drawn from a loaded dataset's keys. Everything
+   is reproducible from the seed. */
+
+/* Write a header line and rows records to path. EZI_ADD looks like the
+   real one ("[UNIT/]NUM ROAD TYPE LOCALITY POSTCODE", house numbers
+   1-999), about one key in ten is shared by several rows, and x/y lie
+   around the locality. Returns 0 on success, -1 on error. */
+int synth_write_csv(const char *path, size_t rows, uint64_t seed);
+
+/* Query classes */
+enum synth_kind {
+    SYNTH_HIT,                  /* a key of the dataset */
+    SYNTH_NEAR,                 /* a key with 1-3 random edits */
+    SYNTH_MISS,                 /* an address absent from any dataset */
+    SYNTH_KINDS
+};
+
+extern const char *const synth_kind_name[SYNTH_KINDS];
+
+/* count queries of one kind built from keys[0..nkeys) (NULLs skipped).
+   Misses use house numbers above 999, so they never match. Each string
+   is malloc'd; free with synth_free_queries. */
+char **synth_queries(const char *const keys[], size_t nkeys, int kind,
+                     size_t count, uint64_t seed);
+
+void synth_free_queries(char **queries, size_t count);
+
+#endif /* SYNTH_H */